@@ -0,0 +1,131 @@
+#include "Async.h"
+#include "Crypto.h"
+#include "Filter.h"
+#include <algorithm>
+#include <fstream>
+
+// Pixels per band of rows filtered between cancellation checks and progress reports.
+static const int BAND_PIXELS = 1 << 16;
+
+
+// Report progress if a callback was given
+static void report(const AsyncOptions& options, double fraction) {
+    if (options.progress) {
+        options.progress(fraction);
+    }
+}
+
+// Filter an image band by band from the unmodified source into a copy, so each band sees the
+// original pixels around it and the result matches filtering the whole image at once.
+template <typename PixelT, typename BandFn>
+static GrayscaleImageT<PixelT> filter_in_bands(const GrayscaleImageT<PixelT>& source, const AsyncOptions& options,
+                                               BandFn filter_band) {
+    GrayscaleImageT<PixelT> target(source);
+    int width = source.get_width();
+    int height = source.get_height();
+    int rows = std::max(1, BAND_PIXELS / std::max(width, 1));
+
+    for (int row = 0; row < height; row += rows) {
+        options.cancellation.throw_if_cancelled();
+        Region band = {row, 0, std::min(rows, height - row), width};
+        filter_band(source, target, band);
+        report(options, static_cast<double>(row + band.height) / height);
+    }
+    if (height == 0) {
+        report(options, 1.0);
+    }
+    return target;
+}
+
+// Load an image file with the throwing loader, since the file constructor exits the process on failure
+template <typename PixelT>
+std::function<GrayscaleImageT<PixelT>()> Async::load_image_job(const std::string& filename,
+                                                               const AsyncOptions& options) {
+    return [filename, options]() -> GrayscaleImageT<PixelT> {
+        options.cancellation.throw_if_cancelled();
+        GrayscaleImageT<PixelT> image = GrayscaleImageT<PixelT>::load(filename.c_str());
+        report(options, 1.0);
+        return image;
+    };
+}
+
+// Mean Filter in bands
+template <typename PixelT>
+std::function<GrayscaleImageT<PixelT>()> Async::mean_filter_job(GrayscaleImageT<PixelT> image, int kernelSize,
+                                                                const AsyncOptions& options) {
+    std::shared_ptr<GrayscaleImageT<PixelT> > source = std::make_shared<GrayscaleImageT<PixelT> >(std::move(image));
+    return [source, kernelSize, options]() -> GrayscaleImageT<PixelT> {
+        return filter_in_bands(*source, options, [kernelSize](const GrayscaleImageT<PixelT>& from,
+                                                              GrayscaleImageT<PixelT>& to, const Region& band) {
+            Filter::apply_mean_filter(from, to, band, kernelSize);
+        });
+    };
+}
+
+// Gaussian Smoothing in bands
+template <typename PixelT>
+std::function<GrayscaleImageT<PixelT>()> Async::gaussian_smoothing_job(GrayscaleImageT<PixelT> image, int kernelSize,
+                                                                       double sigma, const AsyncOptions& options) {
+    std::shared_ptr<GrayscaleImageT<PixelT> > source = std::make_shared<GrayscaleImageT<PixelT> >(std::move(image));
+    return [source, kernelSize, sigma, options]() -> GrayscaleImageT<PixelT> {
+        return filter_in_bands(*source, options, [kernelSize, sigma](const GrayscaleImageT<PixelT>& from,
+                                                                     GrayscaleImageT<PixelT>& to, const Region& band) {
+            Filter::apply_gaussian_smoothing(from, to, band, kernelSize, sigma);
+        });
+    };
+}
+
+// Unsharp Masking in bands
+template <typename PixelT>
+std::function<GrayscaleImageT<PixelT>()> Async::unsharp_mask_job(GrayscaleImageT<PixelT> image, int kernelSize,
+                                                                 double amount, const AsyncOptions& options) {
+    std::shared_ptr<GrayscaleImageT<PixelT> > source = std::make_shared<GrayscaleImageT<PixelT> >(std::move(image));
+    return [source, kernelSize, amount, options]() -> GrayscaleImageT<PixelT> {
+        return filter_in_bands(*source, options, [kernelSize, amount](const GrayscaleImageT<PixelT>& from,
+                                                                      GrayscaleImageT<PixelT>& to, const Region& band) {
+            Filter::apply_unsharp_mask(from, to, band, kernelSize, amount);
+        });
+    };
+}
+
+// Embed the LSB array into the job's own copy of the image
+std::function<SecretImage()> Async::embed_LSBits_job(GrayscaleImage image, std::vector<int> LSB_array,
+                                                     const AsyncOptions& options) {
+    std::shared_ptr<GrayscaleImage> cover = std::make_shared<GrayscaleImage>(std::move(image));
+    std::shared_ptr<std::vector<int> > bits = std::make_shared<std::vector<int> >(std::move(LSB_array));
+    return [cover, bits, options]() -> SecretImage {
+        options.cancellation.throw_if_cancelled();
+        SecretImage secret_image = Crypto::embed_LSBits(*cover, *bits);
+        report(options, 1.0);
+        return secret_image;
+    };
+}
+
+// Load a secret image, failing instead of reading an empty image when the file is missing
+std::function<SecretImage()> Async::load_secret_image_job(const std::string& filename, const AsyncOptions& options) {
+    return [filename, options]() -> SecretImage {
+        options.cancellation.throw_if_cancelled();
+        if (!std::ifstream(filename).is_open()) {
+            throw std::runtime_error("Could not open " + filename);
+        }
+        SecretImage secret_image = SecretImage::load_from_file(filename);
+        report(options, 1.0);
+        return secret_image;
+    };
+}
+
+// Pixel types the asynchronous image functions are provided for.
+#define INSTANTIATE_ASYNC(PixelT) \
+    template std::function<GrayscaleImageT<PixelT>()> Async::load_image_job<PixelT>( \
+        const std::string&, const AsyncOptions&); \
+    template std::function<GrayscaleImageT<PixelT>()> Async::mean_filter_job<PixelT>( \
+        GrayscaleImageT<PixelT>, int, const AsyncOptions&); \
+    template std::function<GrayscaleImageT<PixelT>()> Async::gaussian_smoothing_job<PixelT>( \
+        GrayscaleImageT<PixelT>, int, double, const AsyncOptions&); \
+    template std::function<GrayscaleImageT<PixelT>()> Async::unsharp_mask_job<PixelT>( \
+        GrayscaleImageT<PixelT>, int, double, const AsyncOptions&);
+
+INSTANTIATE_ASYNC(uint8_t)
+INSTANTIATE_ASYNC(uint16_t)
+INSTANTIATE_ASYNC(int)
+INSTANTIATE_ASYNC(float)
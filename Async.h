@@ -0,0 +1,159 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include "Executor.h"
+#include "GrayscaleImage.h"
+#include "SecretImage.h"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Thrown into the future (or the awaiting coroutine) of an operation that was cancelled.
+class OperationCancelled : public std::runtime_error {
+public:
+    OperationCancelled() : std::runtime_error("Operation cancelled") {}
+};
+
+// Shared flag for cancelling operations. Copies refer to the same flag, so the caller keeps one
+// copy and hands another to the operation; operations check it between units of work.
+class CancellationToken {
+private:
+    std::shared_ptr<std::atomic<bool> > flag;
+
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool> >(false)) {}
+
+    void cancel() { flag->store(true); }
+    bool is_cancelled() const { return flag->load(); }
+
+    // Throw OperationCancelled if cancellation was requested
+    void throw_if_cancelled() const {
+        if (is_cancelled()) {
+            throw OperationCancelled();
+        }
+    }
+};
+
+// Called on the executor thread with the completed fraction of an operation, from 0 to 1.
+typedef std::function<void(double)> ProgressCallback;
+
+// Where an operation runs and how it reports back. By default it runs on Executor::shared().
+struct AsyncOptions {
+    Executor* executor;
+    CancellationToken cancellation;
+    ProgressCallback progress;
+
+    AsyncOptions() : executor(nullptr) {}
+    AsyncOptions(const CancellationToken& token, const ProgressCallback& callback = ProgressCallback(),
+                 Executor* ex = nullptr)
+        : executor(ex), cancellation(token), progress(callback) {}
+};
+
+// Asynchronous versions of the library entry points. Each takes its inputs by value, runs on an
+// executor and returns a future; with C++20 coroutines the co_ variants return an awaitable instead.
+// Filters work in bands of rows, checking for cancellation and reporting progress after each band.
+// Image functions are provided for uint8_t, uint16_t, int and float images.
+class Async {
+private:
+    // The work behind each entry point, shared by the future and coroutine variants
+    template <typename PixelT>
+    static std::function<GrayscaleImageT<PixelT>()> load_image_job(const std::string& filename,
+                                                                    const AsyncOptions& options);
+    template <typename PixelT>
+    static std::function<GrayscaleImageT<PixelT>()> mean_filter_job(GrayscaleImageT<PixelT> image, int kernelSize,
+                                                                     const AsyncOptions& options);
+    template <typename PixelT>
+    static std::function<GrayscaleImageT<PixelT>()> gaussian_smoothing_job(GrayscaleImageT<PixelT> image,
+                                                                            int kernelSize, double sigma,
+                                                                            const AsyncOptions& options);
+    template <typename PixelT>
+    static std::function<GrayscaleImageT<PixelT>()> unsharp_mask_job(GrayscaleImageT<PixelT> image, int kernelSize,
+                                                                      double amount, const AsyncOptions& options);
+    static std::function<SecretImage()> embed_LSBits_job(GrayscaleImage image, std::vector<int> LSB_array,
+                                                         const AsyncOptions& options);
+    static std::function<SecretImage()> load_secret_image_job(const std::string& filename,
+                                                              const AsyncOptions& options);
+
+    static Executor& executor_of(const AsyncOptions& options) {
+        return options.executor != nullptr ? *options.executor : Executor::shared();
+    }
+
+public:
+    // Load an image file; a missing or unreadable file fails the future with std::runtime_error
+    template <typename PixelT>
+    static std::future<GrayscaleImageT<PixelT> > load_image(const std::string& filename,
+                                                            const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).submit(load_image_job<PixelT>(filename, options));
+    }
+
+    // Filter an image and return the result
+    template <typename PixelT>
+    static std::future<GrayscaleImageT<PixelT> > apply_mean_filter(GrayscaleImageT<PixelT> image, int kernelSize = 3,
+                                                                   const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).submit(mean_filter_job(std::move(image), kernelSize, options));
+    }
+    template <typename PixelT>
+    static std::future<GrayscaleImageT<PixelT> > apply_gaussian_smoothing(GrayscaleImageT<PixelT> image,
+                                                                          int kernelSize = 3, double sigma = 1.0,
+                                                                          const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).submit(gaussian_smoothing_job(std::move(image), kernelSize, sigma, options));
+    }
+    template <typename PixelT>
+    static std::future<GrayscaleImageT<PixelT> > apply_unsharp_mask(GrayscaleImageT<PixelT> image, int kernelSize = 3,
+                                                                    double amount = 1.5,
+                                                                    const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).submit(unsharp_mask_job(std::move(image), kernelSize, amount, options));
+    }
+
+    // Embed an LSB array into an image and return the secret image
+    static std::future<SecretImage> embed_LSBits(GrayscaleImage image, std::vector<int> LSB_array,
+                                                 const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).submit(embed_LSBits_job(std::move(image), std::move(LSB_array), options));
+    }
+
+    // Load a secret image from a .dat file in either format
+    static std::future<SecretImage> load_secret_image(const std::string& filename,
+                                                      const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).submit(load_secret_image_job(filename, options));
+    }
+
+#if STEGA_HAS_COROUTINES
+    template <typename PixelT>
+    static Executor::RunAwaiter<GrayscaleImageT<PixelT> > co_load_image(const std::string& filename,
+                                                                        const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).run(load_image_job<PixelT>(filename, options));
+    }
+    template <typename PixelT>
+    static Executor::RunAwaiter<GrayscaleImageT<PixelT> > co_apply_mean_filter(GrayscaleImageT<PixelT> image,
+                                                                               int kernelSize = 3,
+                                                                               const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).run(mean_filter_job(std::move(image), kernelSize, options));
+    }
+    template <typename PixelT>
+    static Executor::RunAwaiter<GrayscaleImageT<PixelT> > co_apply_gaussian_smoothing(GrayscaleImageT<PixelT> image,
+                                                                                      int kernelSize = 3, double sigma = 1.0,
+                                                                                      const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).run(gaussian_smoothing_job(std::move(image), kernelSize, sigma, options));
+    }
+    template <typename PixelT>
+    static Executor::RunAwaiter<GrayscaleImageT<PixelT> > co_apply_unsharp_mask(GrayscaleImageT<PixelT> image,
+                                                                                int kernelSize = 3, double amount = 1.5,
+                                                                                const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).run(unsharp_mask_job(std::move(image), kernelSize, amount, options));
+    }
+    static Executor::RunAwaiter<SecretImage> co_embed_LSBits(GrayscaleImage image, std::vector<int> LSB_array,
+                                                             const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).run(embed_LSBits_job(std::move(image), std::move(LSB_array), options));
+    }
+    static Executor::RunAwaiter<SecretImage> co_load_secret_image(const std::string& filename,
+                                                                  const AsyncOptions& options = AsyncOptions()) {
+        return executor_of(options).run(load_secret_image_job(filename, options));
+    }
+#endif
+};
+
+#endif // ASYNC_H
@@ -0,0 +1,59 @@
+#include "CpuDispatch.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Query the CPU for the highest supported level
+CpuDispatch::Level CpuDispatch::detected() {
+#if defined(STEGA_MULTI_ISA)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("popcnt")) {
+        return AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+        return SSE42;
+    }
+#endif
+    return BASELINE;
+}
+
+// Determine the active level once, honoring the STEGAVISION_ISA override
+CpuDispatch::Level CpuDispatch::active() {
+    static const Level level = []() {
+        Level supported = detected();
+        const char* forced = std::getenv("STEGAVISION_ISA");
+        if (forced == nullptr || *forced == '\0') {
+            return supported;
+        }
+
+        for (int candidate = BASELINE; candidate <= AVX512; ++candidate) {
+            if (std::strcmp(forced, name(static_cast<Level>(candidate))) == 0) {
+                // Never run a variant the CPU can't execute.
+                if (candidate > supported) {
+                    std::cerr << "WARNING: STEGAVISION_ISA=" << forced << " is not supported by this CPU, using "
+                              << name(supported) << "." << std::endl;
+                    return supported;
+                }
+                return static_cast<Level>(candidate);
+            }
+        }
+
+        std::cerr << "WARNING: Unknown STEGAVISION_ISA=" << forced << ", using " << name(supported) << "." << std::endl;
+        return supported;
+    }();
+    return level;
+}
+
+// Names as accepted by STEGAVISION_ISA
+const char* CpuDispatch::name(Level level) {
+    switch (level) {
+        case AVX512: return "avx512";
+        case AVX2: return "avx2";
+        case SSE42: return "sse42";
+        default: return "baseline";
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+// Hot kernels are compiled once per instruction set level and the best variant the CPU
+// supports is picked at startup. Setting STEGAVISION_ISA to baseline, sse42, avx2 or avx512
+// forces a lower variant for testing and benchmarking.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STEGA_MULTI_ISA 1
+#endif
+
+// Variant attributes. Floating-point contraction is disabled so every variant rounds like the
+// baseline build and produces identical results.
+#if defined(STEGA_MULTI_ISA) && !defined(__clang__)
+#define STEGA_NO_CONTRACT optimize("fp-contract=off")
+#define STEGA_TARGET_BASELINE __attribute__((STEGA_NO_CONTRACT))
+#define STEGA_TARGET_SSE42 __attribute__((target("sse4.2,popcnt"), STEGA_NO_CONTRACT))
+#define STEGA_TARGET_AVX2 __attribute__((target("avx2,popcnt"), STEGA_NO_CONTRACT))
+#define STEGA_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,popcnt"), STEGA_NO_CONTRACT))
+#elif defined(STEGA_MULTI_ISA)
+#define STEGA_TARGET_BASELINE
+#define STEGA_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define STEGA_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define STEGA_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl,popcnt")))
+#else
+#define STEGA_TARGET_BASELINE
+#define STEGA_TARGET_SSE42
+#define STEGA_TARGET_AVX2
+#define STEGA_TARGET_AVX512
+#endif
+
+// Kernel bodies are force-inlined into each variant so the compiler vectorizes them per target.
+#if defined(__GNUC__)
+#define STEGA_KERNEL_BODY inline __attribute__((always_inline))
+#else
+#define STEGA_KERNEL_BODY inline
+#endif
+
+// Clang contracts within a statement by default; bodies doing floating-point math start with this.
+#if defined(__clang__)
+#define STEGA_KERNEL_NO_CONTRACT _Pragma("clang fp contract(off)")
+#else
+#define STEGA_KERNEL_NO_CONTRACT
+#endif
+
+// Define a struct Name with one static function per instruction set level, each running Body.
+// Params is the parenthesized parameter list and Args the matching argument list.
+#define STEGA_KERNEL_VARIANTS(Name, Body, Params, Args) \
+    struct Name { \
+        STEGA_TARGET_BASELINE static void baseline Params { Body Args; } \
+        STEGA_TARGET_SSE42 static void sse42 Params { Body Args; } \
+        STEGA_TARGET_AVX2 static void avx2 Params { Body Args; } \
+        STEGA_TARGET_AVX512 static void avx512 Params { Body Args; } \
+    }
+
+class CpuDispatch {
+public:
+    enum Level { BASELINE = 0, SSE42 = 1, AVX2 = 2, AVX512 = 3 };
+
+    // Highest level supported by this CPU
+    static Level detected();
+
+    // Level the kernels run at: the detected level, or the STEGAVISION_ISA override if it is lower.
+    // Determined once on first use.
+    static Level active();
+
+    // Name of a level as accepted by STEGAVISION_ISA
+    static const char* name(Level level);
+
+    // Pick the variant of a kernel for the active level
+    template <typename Fn>
+    static Fn select(Fn baseline, Fn sse42, Fn avx2, Fn avx512) {
+        switch (active()) {
+            case AVX512: return avx512;
+            case AVX2: return avx2;
+            case SSE42: return sse42;
+            default: return baseline;
+        }
+    }
+
+    // Pick the variant of a kernel defined with STEGA_KERNEL_VARIANTS
+    template <typename Kernel, typename Fn>
+    static Fn select() {
+        return select<Fn>(&Kernel::baseline, &Kernel::sse42, &Kernel::avx2, &Kernel::avx512);
+    }
+};
+
+#endif // CPU_DISPATCH_H
@@ -1,5 +1,51 @@
 #include "Crypto.h"
 #include "GrayscaleImage.h"
+#include "CpuDispatch.h"
+
+// LSB extract kernel: the least significant bit of each pixel.
+STEGA_KERNEL_BODY void extract_lsb_row_body(const int* pixels, int* bits, int n) {
+    for (int x = 0; x < n; ++x) {
+        bits[x] = pixels[x] & 1;
+    }
+}
+
+// LSB embed kernel: keep the upper 7 of the 8 pixel bits and set bit 0 from the LSB array.
+STEGA_KERNEL_BODY void embed_lsb_row_body(int* pixels, const int* bits, int n) {
+    for (int x = 0; x < n; ++x) {
+        pixels[x] = (pixels[x] & 0xFE) | (bits[x] != 0);
+    }
+}
+
+// k-LSB embed kernel: replace the bits under mask with the given values.
+STEGA_KERNEL_BODY void embed_bits_row_body(int* pixels, const int* values, int mask, int n) {
+    for (int x = 0; x < n; ++x) {
+        pixels[x] = (pixels[x] & ~mask) | values[x];
+    }
+}
+
+STEGA_KERNEL_VARIANTS(ExtractLsbRow, extract_lsb_row_body, (const int* pixels, int* bits, int n), (pixels, bits, n));
+STEGA_KERNEL_VARIANTS(EmbedLsbRow, embed_lsb_row_body, (int* pixels, const int* bits, int n), (pixels, bits, n));
+STEGA_KERNEL_VARIANTS(EmbedBitsRow, embed_bits_row_body, (int* pixels, const int* values, int mask, int n),
+                      (pixels, values, mask, n));
+
+// Dispatchers: each picks its variant for the active instruction set level on first use.
+static void extract_lsb_row(const int* pixels, int* bits, int n) {
+    typedef void (*Fn)(const int*, int*, int);
+    static const Fn kernel = CpuDispatch::select<ExtractLsbRow, Fn>();
+    kernel(pixels, bits, n);
+}
+
+static void embed_lsb_row(int* pixels, const int* bits, int n) {
+    typedef void (*Fn)(int*, const int*, int);
+    static const Fn kernel = CpuDispatch::select<EmbedLsbRow, Fn>();
+    kernel(pixels, bits, n);
+}
+
+static void embed_bits_row(int* pixels, const int* values, int mask, int n) {
+    typedef void (*Fn)(int*, const int*, int, int);
+    static const Fn kernel = CpuDispatch::select<EmbedBitsRow, Fn>();
+    kernel(pixels, values, mask, n);
+}
 
 
 // Extract the least significant bits (LSBs) from SecretImage, calculating x, y based on message length
@@ -28,29 +74,12 @@ std::vector<int> Crypto::extract_LSBits(SecretImage& secret_image, int message_l
     //    the last LSB to extract is in the last pixel of the image.
     int start_index = total_pixel - total_bits;
 
-    // 6. Extract LSBs from the image pixels and return the result.
-    if (start_index > 0) {
-        for (int index = start_index; index < total_pixel; ++index) {
-            int i = index / width; // Calculate row index
-            int j = index % width; // Calculate column index
-
-            // Get the pixel value and extract the least significant bit.
-            int pixel = reconstructed_image.get_pixel(i, j);
-            int pixel_LSB = pixel & 1;
-
-            LSB_array.push_back(pixel_LSB);
-        }
-    } else {
-        // If start_index is less than or equal to 0, extract all pixels from the image.
-        for (int i = 0; i < height; i++) {
-            for (int j = 0; j < width; j++) {
-                // Get the pixel value and extract the least significant bit.
-                int pixel = reconstructed_image.get_pixel(i, j);
-                int pixel_LSB = pixel & 1; // Extract the LSB using bitwise AND operation.
-
-                LSB_array.push_back(pixel_LSB);
-            }
-        }
+    // 6. Extract LSBs from the image pixels and return the result. The pixels are contiguous
+    //    in row-major order; if start_index is less than or equal to 0, extract all of them.
+    start_index = std::max(start_index, 0);
+    LSB_array.resize(total_pixel - start_index);
+    if (total_pixel > 0) {
+        extract_lsb_row(reconstructed_image.get_data()[0] + start_index, LSB_array.data(), total_pixel - start_index);
     }
     return LSB_array;
 }
@@ -120,47 +149,172 @@ SecretImage Crypto::embed_LSBits(GrayscaleImage& image, const std::vector<int>&
     //    the last LSB to embed should end up in the last pixel of the image.
     int start_index = total_pixel - static_cast<int>(LSB_array.size());
 
-    int LSB_index = 0;
-
-    // 3. Iterate over the image pixels, embedding LSBs from the array.
-    if (start_index > 0) {
-        for (int index = start_index; index < total_pixel; ++index) {
-            int i = index / width; // Calculate the row index.
-            int j = index % width; // Calculate the column index.
-            int pixel = image.get_pixel(i, j);
-
-            // Convert pixel value to an 8-bit bitset to modify the LSB.
-            std::bitset<8> pixel_bit_value(pixel);
+    // 3. Embed the LSBs from the array into the pixels, which are contiguous in row-major order.
+    //    If the starting index is 0 or less, embed into the entire image.
+    if (total_pixel > 0) {
+        int* pixels = image.get_data()[0];
+        if (start_index > 0) {
+            embed_lsb_row(pixels + start_index, LSB_array.data(), total_pixel - start_index);
+        } else {
+            embed_lsb_row(pixels, LSB_array.data(), total_pixel);
+        }
+    }
 
-            // Get the next bit from the LSB array to embed.
-            int bit = LSB_array[LSB_index++];
+    // 4. Return a SecretImage object constructed from the given GrayscaleImage
+    //    with the embedded message.
+    SecretImage secret_image(image);
+    return secret_image;
+}
 
-            pixel_bit_value.set(0, bit);
-            // Convert the modified bitset back to an integer pixel value.
-            pixel = static_cast<int>(pixel_bit_value.to_ulong());
-            image.set_pixel(i, j, pixel);
+// Read count bits starting at bit_index from a byte string, most significant bit first.
+// Bits past the end of the string read as 0.
+static unsigned int read_bits(const std::string& bytes, long long bit_index, int count) {
+    unsigned int value = 0;
+    for (int b = 0; b < count; ++b, ++bit_index) {
+        int bit = 0;
+        if (bit_index < static_cast<long long>(bytes.size()) * 8) {
+            unsigned char byte = static_cast<unsigned char>(bytes[bit_index / 8]);
+            bit = (byte >> (7 - bit_index % 8)) & 1;
         }
+        value = (value << 1) | bit;
     }
-    else {
-        // If starting index is 0 or less, iterate over the entire image and embed LSBs.
-        for (int i = 0; i < height; i++) {
-            for (int j = 0; j < width; j++) {
-                int pixel = image.get_pixel(i, j);
-
-                // Convert pixel value to an 8-bit bitset to modify the LSB.
-                std::bitset<8> pixel_bit_value(pixel);
-                int bit = LSB_array[LSB_index++];
-                pixel_bit_value.set(0, bit);
-
-                // Convert the modified bitset back to an integer pixel value.
-                pixel = static_cast<int>(pixel_bit_value.to_ulong());
-                image.set_pixel(i, j, pixel);
-            }
+    return value;
+}
+
+// Write the low count bits of value starting at bit_index into a byte string, most significant bit first.
+// Bits past the end of the string are dropped.
+static void write_bits(std::string& bytes, long long bit_index, int count, unsigned int value) {
+    for (int b = count - 1; b >= 0; --b, ++bit_index) {
+        if (bit_index < static_cast<long long>(bytes.size()) * 8) {
+            int bit = static_cast<int>((value >> b) & 1);
+            bytes[bit_index / 8] = static_cast<char>(bytes[bit_index / 8] | (bit << (7 - bit_index % 8)));
         }
     }
+}
 
-    // 4. Return a SecretImage object constructed from the given GrayscaleImage
-    //    with the embedded message.
+// Encrypt a binary payload by converting each byte into 8 LSBs
+std::vector<int> Crypto::encrypt_bytes(const std::string& payload) {
+    std::vector<int> LSB_array;
+    LSB_array.reserve(payload.size() * 8);
+
+    // Collect the bits of each byte, most significant bit first.
+    for (size_t i = 0; i < payload.size() * 8; ++i) {
+        LSB_array.push_back(static_cast<int>(read_bits(payload, i, 1)));
+    }
+    return LSB_array;
+}
+
+// Decrypt a binary payload by converting each group of 8 LSBs into a byte
+std::string Crypto::decrypt_bytes(const std::vector<int>& LSB_array) {
+
+    // 1. Verify that the LSB array size is a multiple of 8, else throw an error.
+    if (LSB_array.size() % 8 != 0) {
+        throw std::invalid_argument("LSB array size is not a multiple of 8");
+    }
+
+    // 2. Pack the bits back into bytes.
+    std::string payload(LSB_array.size() / 8, '\0');
+    for (size_t i = 0; i < LSB_array.size(); ++i) {
+        write_bits(payload, i, 1, LSB_array[i] != 0);
+    }
+    return payload;
+}
+
+// Number of payload bytes that fit after the header at the given bits per pixel
+int Crypto::payload_capacity(int width, int height, int bits_per_pixel) {
+    long long payload_pixels = static_cast<long long>(width) * height - HEADER_BITS;
+    if (payload_pixels <= 0) {
+        return 0;
+    }
+    long long capacity = payload_pixels * bits_per_pixel / 8;
+    return static_cast<int>(std::min<long long>(capacity, std::numeric_limits<int>::max()));
+}
+
+// Embed a framed payload starting from the first pixel of the image
+SecretImage Crypto::embed_payload(GrayscaleImage& image, const std::string& payload, int bits_per_pixel) {
+
+    int width = image.get_width();
+    int height = image.get_height();
+
+    // 1. Validate the bits per pixel and ensure the image can hold the header and the payload.
+    if (bits_per_pixel < 1 || bits_per_pixel > MAX_BITS_PER_PIXEL) {
+        throw std::invalid_argument("Bits per pixel must be between 1 and 4");
+    }
+    if (static_cast<long long>(width) * height < HEADER_BITS) {
+        throw std::length_error("Image is too small to hold a payload header");
+    }
+    if (static_cast<long long>(payload.size()) > payload_capacity(width, height, bits_per_pixel)) {
+        throw std::length_error("Image can't hold the payload");
+    }
+
+    // 2. Build the header and embed it one bit per pixel.
+    std::string header(HEADER_BITS / 8, '\0');
+    write_bits(header, 0, 8, HEADER_VERSION);
+    write_bits(header, 8, 8, static_cast<unsigned int>(bits_per_pixel));
+    write_bits(header, 16, 32, static_cast<unsigned int>(payload.size()));
+
+    for (int index = 0; index < HEADER_BITS; ++index) {
+        int i = index / width;
+        int j = index % width;
+        image.set_pixel(i, j, (image.get_pixel(i, j) & ~1) | static_cast<int>(read_bits(header, index, 1)));
+    }
+
+    // 3. Embed the payload bits_per_pixel bits at a time into the pixels following the header.
+    //    The last pixel is padded with zero bits.
+    int mask = (1 << bits_per_pixel) - 1;
+    long long payload_pixels = (static_cast<long long>(payload.size()) * 8 + bits_per_pixel - 1) / bits_per_pixel;
+
+    std::vector<int> values(static_cast<size_t>(payload_pixels));
+    for (long long p = 0; p < payload_pixels; ++p) {
+        values[p] = static_cast<int>(read_bits(payload, p * bits_per_pixel, bits_per_pixel));
+    }
+    embed_bits_row(image.get_data()[0] + HEADER_BITS, values.data(), mask, static_cast<int>(payload_pixels));
+
+    // 4. Return a SecretImage object constructed from the image with the embedded payload.
     SecretImage secret_image(image);
     return secret_image;
-}
\ No newline at end of file
+}
+
+// Extract a framed payload, stopping as soon as the payload length given in the header is read
+std::string Crypto::extract_payload(const SecretImage& secret_image) {
+
+    int width = secret_image.get_width();
+    int height = secret_image.get_height();
+
+    if (static_cast<long long>(width) * height < HEADER_BITS) {
+        throw std::runtime_error("Image is too small to hold a payload header");
+    }
+
+    // 1. Read the header from the LSB of the first pixels.
+    std::string header(HEADER_BITS / 8, '\0');
+    for (int index = 0; index < HEADER_BITS; ++index) {
+        write_bits(header, index, 1, static_cast<unsigned int>(secret_image.get_pixel(index / width, index % width) & 1));
+    }
+
+    int version = static_cast<int>(read_bits(header, 0, 8));
+    int bits_per_pixel = static_cast<int>(read_bits(header, 8, 8));
+    unsigned int length = read_bits(header, 16, 32);
+
+    // 2. Validate the header before trusting the length.
+    if (version != HEADER_VERSION) {
+        throw std::runtime_error("Unsupported payload header version");
+    }
+    if (bits_per_pixel < 1 || bits_per_pixel > MAX_BITS_PER_PIXEL) {
+        throw std::runtime_error("Invalid bits per pixel in payload header");
+    }
+    if (length > static_cast<unsigned int>(payload_capacity(width, height, bits_per_pixel))) {
+        throw std::runtime_error("Payload length in header exceeds image capacity");
+    }
+
+    // 3. Read only the pixels that hold the payload.
+    std::string payload(length, '\0');
+    int mask = (1 << bits_per_pixel) - 1;
+    long long payload_pixels = (static_cast<long long>(length) * 8 + bits_per_pixel - 1) / bits_per_pixel;
+
+    for (long long p = 0; p < payload_pixels; ++p) {
+        long long index = HEADER_BITS + p;
+        int pixel = secret_image.get_pixel(static_cast<int>(index / width), static_cast<int>(index % width));
+        write_bits(payload, p * bits_per_pixel, bits_per_pixel, static_cast<unsigned int>(pixel & mask));
+    }
+    return payload;
+}
@@ -8,6 +8,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <limits>
 
 class Crypto {
 public:
@@ -22,6 +23,28 @@ public:
 
     // Function to embed LSB array into SecretImage
     static SecretImage embed_LSBits(GrayscaleImage& image, const std::vector<int>& LSB_array);
+
+    // Framed payloads start with a header of HEADER_BITS bits, one per pixel from the first pixel:
+    // 8-bit version, 8-bit bits per pixel and 32-bit payload length in bytes, most significant bit first.
+    // The payload follows in the low 1 to MAX_BITS_PER_PIXEL bits of each pixel.
+    static const int HEADER_VERSION = 1;
+    static const int HEADER_BITS = 48;
+    static const int MAX_BITS_PER_PIXEL = 4;
+
+    // Function to convert a binary payload into an LSB array with 8 bits per byte
+    static std::vector<int> encrypt_bytes(const std::string& payload);
+
+    // Function to convert an LSB array with 8 bits per byte back into a binary payload
+    static std::string decrypt_bytes(const std::vector<int>& LSB_array);
+
+    // Number of payload bytes a framed embedding can hold in an image of the given size
+    static int payload_capacity(int width, int height, int bits_per_pixel = 1);
+
+    // Function to embed a framed payload into the image, throws if it does not fit
+    static SecretImage embed_payload(GrayscaleImage& image, const std::string& payload, int bits_per_pixel = 1);
+
+    // Function to extract a framed payload, reading only the header and the pixels that hold the payload
+    static std::string extract_payload(const SecretImage& secret_image);
 };
 
 #endif // CRYPTO_H
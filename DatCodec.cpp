@@ -0,0 +1,345 @@
+#include "DatCodec.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+static const char MAGIC[4] = {'S', 'V', 'Z', '1'};
+
+// Unary quotients of this many ones are followed by the raw 32-bit residual instead.
+static const int ESCAPE = 24;
+
+// Chunks encoded or decoded together per thread and batch.
+static const int CHUNKS_PER_THREAD = 4;
+
+// Appends bits to a byte string, least significant bit first.
+class BitWriter {
+private:
+    std::string& out;
+    uint64_t buffer;
+    int bits;
+
+public:
+    explicit BitWriter(std::string& target) : out(target), buffer(0), bits(0) {}
+
+    // Append the low `count` (at most 32) bits of value.
+    void put(uint64_t value, int count) {
+        buffer |= value << bits;
+        bits += count;
+        if (bits >= 32) {
+            char word[4] = {static_cast<char>(buffer), static_cast<char>(buffer >> 8),
+                            static_cast<char>(buffer >> 16), static_cast<char>(buffer >> 24)};
+            out.append(word, 4);
+            buffer >>= 32;
+            bits -= 32;
+        }
+    }
+
+    // Append the remaining bits, padding the last byte with zeros.
+    void flush() {
+        while (bits > 0) {
+            out += static_cast<char>(buffer & 0xFF);
+            buffer >>= 8;
+            bits -= 8;
+        }
+        bits = 0;
+        buffer = 0;
+    }
+};
+
+// Reads bits from a byte string, least significant bit first. Reading past the end yields zeros;
+// exhausted() tells whether that happened.
+class BitReader {
+private:
+    const unsigned char* data;
+    size_t size;
+    size_t pos;
+    uint64_t buffer;
+    int bits;
+
+public:
+    BitReader(const std::string& bytes)
+        : data(reinterpret_cast<const unsigned char*>(bytes.data())), size(bytes.size()), pos(0), buffer(0), bits(0) {}
+
+    // Make at least 57 bits available.
+    void refill() {
+        while (bits <= 56) {
+            buffer |= static_cast<uint64_t>(pos < size ? data[pos] : 0) << bits;
+            ++pos;
+            bits += 8;
+        }
+    }
+
+    // Number of consecutive one bits at the front, without consuming them.
+    int leading_ones() const {
+        uint64_t zeros = ~buffer;
+        if (zeros == 0) {
+            return 64;
+        }
+#if defined(__GNUC__)
+        return __builtin_ctzll(zeros);
+#else
+        int count = 0;
+        while ((zeros & 1) == 0) {
+            zeros >>= 1;
+            ++count;
+        }
+        return count;
+#endif
+    }
+
+    // Consume `count` (less than 64) bits.
+    uint64_t take(int count) {
+        uint64_t value = buffer & ((1ULL << count) - 1);
+        buffer >>= count;
+        bits -= count;
+        return value;
+    }
+
+    bool exhausted() const {
+        return static_cast<unsigned long long>(pos) * 8 - bits > static_cast<unsigned long long>(size) * 8;
+    }
+};
+
+// Write a 32-bit value, least significant byte first.
+static void put_u32(std::ostream& out, uint32_t value) {
+    char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8),
+                     static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+    out.write(bytes, 4);
+}
+
+// Read a 32-bit value, least significant byte first.
+static uint32_t get_u32(std::istream& in) {
+    unsigned char bytes[4];
+    if (!in.read(reinterpret_cast<char*>(bytes), 4)) {
+        throw std::runtime_error("Compressed .dat file is truncated");
+    }
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+// Encode the left-neighbor differences of a chunk
+std::string DatCodec::encode_chunk(const int* values, int count) {
+    std::string bytes;
+    bytes.reserve(count + 16);
+    BitWriter writer(bytes);
+
+    uint32_t previous = 0;
+    uint32_t residuals[BLOCK_VALUES];
+
+    for (int start = 0; start < count; start += BLOCK_VALUES) {
+        int n = std::min(static_cast<int>(BLOCK_VALUES), count - start);
+
+        // 1. Predict each value by the previous one and zigzag the difference so small
+        //    negative and positive differences both become small codes.
+        uint64_t sum = 0;
+        for (int i = 0; i < n; ++i) {
+            uint32_t value = static_cast<uint32_t>(values[start + i]);
+            uint32_t delta = value - previous;
+            previous = value;
+            residuals[i] = (delta << 1) ^ (0u - (delta >> 31));
+            sum += residuals[i];
+        }
+
+        // 2. Pick the Rice parameter from the block mean.
+        int k = 0;
+        while (k < 31 && (static_cast<uint64_t>(n) << (k + 1)) <= sum) {
+            k++;
+        }
+        writer.put(static_cast<uint64_t>(k), 5);
+
+        // 3. Quotient in unary, then the k low bits; large quotients escape to the raw residual.
+        for (int i = 0; i < n; ++i) {
+            uint32_t quotient = residuals[i] >> k;
+            if (quotient < static_cast<uint32_t>(ESCAPE)) {
+                writer.put((1ULL << quotient) - 1, static_cast<int>(quotient) + 1);
+                writer.put(residuals[i] & ((1ULL << k) - 1), k);
+            } else {
+                writer.put((1ULL << ESCAPE) - 1, ESCAPE);
+                writer.put(residuals[i], 32);
+            }
+        }
+    }
+    writer.flush();
+    return bytes;
+}
+
+// Decode a chunk written by encode_chunk
+void DatCodec::decode_chunk(const std::string& bytes, int* values, int count) {
+    BitReader reader(bytes);
+    uint32_t previous = 0;
+
+    for (int start = 0; start < count; start += BLOCK_VALUES) {
+        int n = std::min(static_cast<int>(BLOCK_VALUES), count - start);
+
+        reader.refill();
+        int k = static_cast<int>(reader.take(5));
+
+        // Every value fits in the 57 bits one refill provides: at most 24 + 1 + 31 or 24 + 32 bits.
+        for (int i = 0; i < n; ++i) {
+            reader.refill();
+            uint32_t residual;
+            int ones = reader.leading_ones();
+            if (ones < ESCAPE) {
+                reader.take(ones + 1);
+                residual = (static_cast<uint32_t>(ones) << k) | static_cast<uint32_t>(reader.take(k));
+            } else {
+                reader.take(ESCAPE);
+                residual = static_cast<uint32_t>(reader.take(32));
+            }
+
+            uint32_t delta = (residual >> 1) ^ (0u - (residual & 1));
+            previous += delta;
+            values[start + i] = static_cast<int>(previous);
+        }
+    }
+
+    if (reader.exhausted()) {
+        throw std::runtime_error("Compressed .dat chunk is truncated");
+    }
+}
+
+// Check for the magic bytes and rewind
+bool DatCodec::is_compressed(std::istream& in) {
+    std::streampos start = in.tellg();
+    char magic[4] = {0, 0, 0, 0};
+    in.read(magic, 4);
+    bool compressed = in.gcount() == 4 && std::memcmp(magic, MAGIC, 4) == 0;
+    in.clear();
+    in.seekg(start);
+    return compressed;
+}
+
+// Values [begin, begin + count) of the concatenated upper/lower stream: a pointer into one array
+// when the range lies inside it, otherwise a copy in `scratch`.
+static const int* stream_range(const int* upper, int upper_count, const int* lower, long long begin, int count,
+                               std::vector<int>& scratch) {
+    if (begin + count <= upper_count) {
+        return upper + begin;
+    }
+    if (begin >= upper_count) {
+        return lower + (begin - upper_count);
+    }
+    scratch.resize(count);
+    for (int i = 0; i < count; ++i) {
+        long long index = begin + i;
+        scratch[i] = index < upper_count ? upper[index] : lower[index - upper_count];
+    }
+    return scratch.data();
+}
+
+// Write the header and the chunk records
+void DatCodec::write(std::ostream& out, int width, int height, const int* upper, int upper_count,
+                     const int* lower, int lower_count, int chunk_values, int threads) {
+    if (chunk_values <= 0) {
+        chunk_values = DEFAULT_CHUNK_VALUES;
+    }
+    if (threads <= 0) {
+        threads = Parallel::default_threads();
+    }
+
+    // 1. Header.
+    out.write(MAGIC, 4);
+    put_u32(out, static_cast<uint32_t>(width));
+    put_u32(out, static_cast<uint32_t>(height));
+
+    // 2. Encode a batch of chunks in parallel, then stream it out in order.
+    long long total = static_cast<long long>(upper_count) + lower_count;
+    long long chunks = (total + chunk_values - 1) / chunk_values;
+    int batch = threads * CHUNKS_PER_THREAD;
+
+    for (long long first = 0; first < chunks; first += batch) {
+        int n = static_cast<int>(std::min<long long>(batch, chunks - first));
+        std::vector<std::string> coded(n);
+        std::vector<int> counts(n);
+
+        Parallel::for_each_index(n, [&](int i) {
+            long long begin = (first + i) * chunk_values;
+            counts[i] = static_cast<int>(std::min<long long>(chunk_values, total - begin));
+            std::vector<int> scratch;
+            const int* values = stream_range(upper, upper_count, lower, begin, counts[i], scratch);
+            coded[i] = encode_chunk(values, counts[i]);
+        }, threads);
+
+        for (int i = 0; i < n; ++i) {
+            put_u32(out, static_cast<uint32_t>(counts[i]));
+            put_u32(out, static_cast<uint32_t>(coded[i].size()));
+            out.write(coded[i].data(), static_cast<std::streamsize>(coded[i].size()));
+        }
+    }
+}
+
+// Read and check the header
+void DatCodec::read_header(std::istream& in, int& width, int& height) {
+    char magic[4];
+    if (!in.read(magic, 4) || std::memcmp(magic, MAGIC, 4) != 0) {
+        throw std::runtime_error("Not a compressed .dat file");
+    }
+    width = static_cast<int>(get_u32(in));
+    height = static_cast<int>(get_u32(in));
+    if (width < 0 || height < 0 ||
+        static_cast<long long>(width) * height > std::numeric_limits<int>::max()) {
+        throw std::runtime_error("Invalid image size in compressed .dat file");
+    }
+}
+
+// Read a batch of chunk records, decode them in parallel and repeat until both arrays are filled
+void DatCodec::read_arrays(std::istream& in, int* upper, int upper_count, int* lower, int lower_count, int threads) {
+    if (threads <= 0) {
+        threads = Parallel::default_threads();
+    }
+    long long total = static_cast<long long>(upper_count) + lower_count;
+    long long filled = 0;
+    int batch = threads * CHUNKS_PER_THREAD;
+
+    while (filled < total) {
+
+        // 1. Read up to a batch of records, checking each against the space left.
+        std::vector<std::string> coded;
+        std::vector<long long> begins;
+        std::vector<int> counts;
+        while (filled < total && static_cast<int>(coded.size()) < batch) {
+            uint32_t count = get_u32(in);
+            uint32_t size = get_u32(in);
+
+            // A value takes at most 56 bits and a block header 5.
+            unsigned long long max_size = (static_cast<unsigned long long>(count) * 61 + 7) / 8 + 8;
+            if (count == 0 || count > total - filled || size > max_size) {
+                throw std::runtime_error("Corrupt chunk record in compressed .dat file");
+            }
+
+            std::string bytes(size, '\0');
+            if (size > 0 && !in.read(&bytes[0], size)) {
+                throw std::runtime_error("Compressed .dat file is truncated");
+            }
+            coded.push_back(std::move(bytes));
+            begins.push_back(filled);
+            counts.push_back(static_cast<int>(count));
+            filled += count;
+        }
+
+        // 2. Decode the batch in parallel, straight into the arrays unless a chunk spans both.
+        Parallel::for_each_index(static_cast<int>(coded.size()), [&](int i) {
+            long long begin = begins[i];
+            int count = counts[i];
+            if (begin + count <= upper_count) {
+                decode_chunk(coded[i], upper + begin, count);
+            } else if (begin >= upper_count) {
+                decode_chunk(coded[i], lower + (begin - upper_count), count);
+            } else {
+                std::vector<int> values(count);
+                decode_chunk(coded[i], values.data(), count);
+                for (int v = 0; v < count; ++v) {
+                    long long index = begin + v;
+                    if (index < upper_count) {
+                        upper[index] = values[v];
+                    } else {
+                        lower[index - upper_count] = values[v];
+                    }
+                }
+            }
+        }, threads);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef DAT_CODEC_H
+#define DAT_CODEC_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+// Compressed variant of the .dat format. The upper and then the lower triangular array form one
+// stream of values, cut into chunks that are encoded and decoded independently:
+//
+//   "SVZ1", width, height                      header, 32-bit little-endian fields
+//   value count, byte count, coded bytes       one record per chunk
+//
+// Within a chunk each value is predicted by the one before it along the triangular order (its
+// left neighbor, except at row starts), and the zigzagged differences are Rice coded in blocks
+// of BLOCK_VALUES with a 5-bit parameter per block.
+class DatCodec {
+public:
+    static const int DEFAULT_CHUNK_VALUES = 1 << 16;
+    static const int BLOCK_VALUES = 32;
+
+    // Check for the compressed header without consuming it
+    static bool is_compressed(std::istream& in);
+
+    // Write the header and both arrays, encoding batches of chunks in parallel on up to
+    // `threads` threads (0 for one per core) and streaming each batch out in order.
+    static void write(std::ostream& out, int width, int height, const int* upper, int upper_count,
+                      const int* lower, int lower_count, int chunk_values = DEFAULT_CHUNK_VALUES, int threads = 0);
+
+    // Read the header; throws if the stream is not in the compressed format.
+    static void read_header(std::istream& in, int& width, int& height);
+
+    // Read the chunk records following the header into arrays of the given sizes,
+    // decoding batches of chunks in parallel. Throws on truncated or corrupt data.
+    static void read_arrays(std::istream& in, int* upper, int upper_count, int* lower, int lower_count, int threads = 0);
+
+    // Encode or decode a single chunk of values
+    static std::string encode_chunk(const int* values, int count);
+    static void decode_chunk(const std::string& bytes, int* values, int count);
+};
+
+#endif // DAT_CODEC_H
@@ -0,0 +1,61 @@
+#include "Executor.h"
+#include "Parallel.h"
+
+
+// Constructor: start the worker threads
+Executor::Executor(int threads) : stopping(false) {
+    if (threads <= 0) {
+        threads = Parallel::default_threads();
+    }
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread(&Executor::work_loop, this));
+    }
+}
+
+// Destructor: let the workers drain the queue, then join them
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Process-wide executor, started on first use
+Executor& Executor::shared() {
+    static Executor executor;
+    return executor;
+}
+
+// Queue a task and wake one worker
+void Executor::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    available.notify_one();
+}
+
+// Take tasks off the queue one at a time, running each outside the lock
+void Executor::work_loop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        try {
+            task();
+        } catch (...) {
+            // Posted tasks have nowhere to report errors; submit() captures them in the future.
+        }
+    }
+}
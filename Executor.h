@@ -0,0 +1,126 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+#include <coroutine>
+#include <optional>
+#define STEGA_HAS_COROUTINES 1
+#else
+#define STEGA_HAS_COROUTINES 0
+#endif
+
+// Fixed pool of worker threads running queued tasks in submission order. Many jobs can be in
+// flight while only the pool threads run them; the shared() pool has one thread per core.
+class Executor {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()> > tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping;
+
+    // Run tasks until the executor stops and the queue is empty.
+    void work_loop();
+
+public:
+    // Constructor: start `threads` workers (0 for one per core)
+    explicit Executor(int threads = 0);
+
+    // Destructor: run the tasks still queued, then join the workers
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // Executor shared by the whole process
+    static Executor& shared();
+
+    // Number of worker threads
+    int size() const { return static_cast<int>(workers.size()); }
+
+    // Queue a task; exceptions it throws are discarded, so use submit() to observe them.
+    void post(std::function<void()> task);
+
+    // Type returned by calling fn()
+    template <typename Fn>
+    struct Result {
+        typedef decltype(std::declval<Fn&>()()) type;
+    };
+
+    // Queue fn and return a future for its result or exception
+    template <typename Fn>
+    std::future<typename Result<Fn>::type> submit(Fn fn) {
+        typedef typename Result<Fn>::type result_type;
+        std::shared_ptr<std::packaged_task<result_type()> > task =
+            std::make_shared<std::packaged_task<result_type()> >(std::move(fn));
+        std::future<result_type> result = task->get_future();
+        post([task]() { (*task)(); });
+        return result;
+    }
+
+#if STEGA_HAS_COROUTINES
+    // co_await executor.schedule() continues the coroutine on a pool thread.
+    struct ScheduleAwaiter {
+        Executor& executor;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { executor.post([handle]() { handle.resume(); }); }
+        void await_resume() const noexcept {}
+    };
+
+    ScheduleAwaiter schedule() { return ScheduleAwaiter{*this}; }
+
+    // co_await executor.run(fn) runs fn on a pool thread without blocking the awaiting thread,
+    // then continues the coroutine on that pool thread with fn's result, or rethrows its exception.
+    template <typename T>
+    class RunAwaiter {
+    private:
+        Executor& executor;
+        std::function<T()> work;
+        std::optional<T> result;
+        std::exception_ptr error;
+
+    public:
+        RunAwaiter(Executor& ex, std::function<T()> fn) : executor(ex), work(std::move(fn)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            executor.post([this, handle]() {
+                try {
+                    result.emplace(work());
+                } catch (...) {
+                    error = std::current_exception();
+                }
+                handle.resume();
+            });
+        }
+
+        T await_resume() {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+            return std::move(*result);
+        }
+    };
+
+    template <typename Fn>
+    RunAwaiter<typename Result<Fn>::type> run(Fn fn) {
+        return RunAwaiter<typename Result<Fn>::type>(*this, std::move(fn));
+    }
+#endif
+};
+
+#endif // EXECUTOR_H
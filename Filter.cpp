@@ -1,136 +1,417 @@
 #include "Filter.h"
+#include "CpuDispatch.h"
 #include <algorithm>
 #include <cmath>
 #include <vector>
 #include <numeric>
+#include <iostream>
 #include <math.h>
 
+// Copy the pixels covered by a region into a flat row-major buffer.
+template <typename PixelT>
+static void copy_region(const GrayscaleImageT<PixelT>& image, const Region& region, std::vector<PixelT>& buffer) {
+    buffer.resize(region.height * region.width);
+    for (int r = 0; r < region.height; r++) {
+        for (int c = 0; c < region.width; c++) {
+            buffer[r * region.width + c] = image.get_pixel(region.row + r, region.col + c);
+        }
+    }
+}
+
+// Grow a region by the kernel edge on every side, clipped to the image.
+static Region halo_of(const Region& region, int edge, int row, int col) {
+    Region halo = {region.row - edge, region.col - edge, region.height + 2 * edge, region.width + 2 * edge};
+    return halo.clipped(row, col);
+}
+
+// Both images of a source/target pair must have the same dimensions.
+template <typename PixelT>
+static bool same_size(const GrayscaleImageT<PixelT>& source, const GrayscaleImageT<PixelT>& target) {
+    if (source.get_width() != target.get_width() || source.get_height() != target.get_height()) {
+        std::cerr << "ERROR: Source and target images differ in size." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Create a Gaussian kernel based on the given sigma value and return the sum of its values.
+static double build_gaussian_kernel(int kernelSize, double sigma, std::vector<double>& kernel) {
+    int edge = (kernelSize - 1) / 2;
+    kernel.assign(kernelSize * kernelSize, 0.0);
+
+    double sum = 0.0;
+
+    // Calculate the values for the Gaussian kernel and keep track of their sum.
+    for (int x = -edge; x <= edge; ++x) {
+        for (int y = -edge; y <= edge; ++y) {
+            double exponent = -(x * x + y * y) / (2 * sigma * sigma);
+            kernel[(x + edge) * kernelSize + (y + edge)] = exp(exponent) / (2 * M_PI * sigma * sigma);
+            sum += kernel[(x + edge) * kernelSize + (y + edge)];
+        }
+    }
+    return sum;
+}
+
+// Box sum kernel: add one row of pixels to the column sums and/or subtract another.
+template <typename AccT, typename PixelT>
+STEGA_KERNEL_BODY void box_sum_row_body(AccT* acc, const PixelT* add, const PixelT* sub, int n) {
+    if (sub == nullptr) {
+        for (int x = 0; x < n; ++x) {
+            acc[x] += add[x];
+        }
+    } else if (add == nullptr) {
+        for (int x = 0; x < n; ++x) {
+            acc[x] -= sub[x];
+        }
+    } else {
+        for (int x = 0; x < n; ++x) {
+            acc[x] += static_cast<AccT>(add[x]) - static_cast<AccT>(sub[x]);
+        }
+    }
+}
+
+// Convolution kernel: add one normalized kernel tap applied to a row of pixels.
+template <typename PixelT>
+STEGA_KERNEL_BODY void convolve_row_body(double* acc, const PixelT* src, double weight, double sum, int n) {
+    STEGA_KERNEL_NO_CONTRACT
+    for (int x = 0; x < n; ++x) {
+        acc[x] += src[x] * weight / sum;
+    }
+}
+
+// Unsharp kernel: original + amount * (original - blurred), clipped to [0, max_value].
+template <typename PixelT>
+STEGA_KERNEL_BODY void unsharp_row_body(PixelT* out, const PixelT* original, const double* blurred,
+                                        double amount, double max_value, int n) {
+    STEGA_KERNEL_NO_CONTRACT
+    for (int x = 0; x < n; ++x) {
+        double originalPixel = original[x];
+        double gaussianPixel = static_cast<PixelT>(blurred[x]);
+        double maskedPixel = originalPixel + amount * (originalPixel - gaussianPixel);
+        maskedPixel = maskedPixel > max_value ? max_value : maskedPixel;
+        maskedPixel = maskedPixel < 0 ? 0 : maskedPixel;
+        out[x] = static_cast<PixelT>(maskedPixel);
+    }
+}
+
+template <typename AccT, typename PixelT>
+STEGA_KERNEL_VARIANTS(BoxSumRow, (box_sum_row_body<AccT, PixelT>),
+                      (AccT* acc, const PixelT* add, const PixelT* sub, int n), (acc, add, sub, n));
+
+template <typename PixelT>
+STEGA_KERNEL_VARIANTS(ConvolveRow, (convolve_row_body<PixelT>),
+                      (double* acc, const PixelT* src, double weight, double sum, int n), (acc, src, weight, sum, n));
+
+template <typename PixelT>
+STEGA_KERNEL_VARIANTS(UnsharpRow, (unsharp_row_body<PixelT>),
+                      (PixelT* out, const PixelT* original, const double* blurred, double amount, double max_value, int n),
+                      (out, original, blurred, amount, max_value, n));
+
+// Dispatchers: each picks its variant for the active instruction set level on first use.
+template <typename AccT, typename PixelT>
+static void box_sum_row(AccT* acc, const PixelT* add, const PixelT* sub, int n) {
+    typedef void (*Fn)(AccT*, const PixelT*, const PixelT*, int);
+    static const Fn kernel = CpuDispatch::select<BoxSumRow<AccT, PixelT>, Fn>();
+    kernel(acc, add, sub, n);
+}
+
+template <typename PixelT>
+static void convolve_row(double* acc, const PixelT* src, double weight, double sum, int n) {
+    typedef void (*Fn)(double*, const PixelT*, double, double, int);
+    static const Fn kernel = CpuDispatch::select<ConvolveRow<PixelT>, Fn>();
+    kernel(acc, src, weight, sum, n);
+}
+
+template <typename PixelT>
+static void unsharp_row(PixelT* out, const PixelT* original, const double* blurred, double amount, double max_value, int n) {
+    typedef void (*Fn)(PixelT*, const PixelT*, const double*, double, double, int);
+    static const Fn kernel = CpuDispatch::select<UnsharpRow<PixelT>, Fn>();
+    kernel(out, original, blurred, amount, max_value, n);
+}
+
+// Weighted sums for one row of the region, read from a halo window. Taps are applied to whole
+// row segments in kernel order, so every pixel sums its in-image neighbors in the same order as
+// a per-pixel loop; neighbors outside the window are outside the image as well and are skipped.
+template <typename PixelT>
+static void gaussian_row(const std::vector<PixelT>& window, const Region& halo, const Region& roi, int r,
+                         const std::vector<double>& kernel, int kernelSize, double sum, std::vector<double>& weightedSum) {
+    int edge = (kernelSize - 1) / 2;
+    weightedSum.assign(roi.width, 0.0);
+
+    for (int i = -edge; i <= edge; ++i) {
+        int neighborRow = r + i - halo.row;
+        if (neighborRow < 0 || neighborRow >= halo.height) {
+            continue;
+        }
+        for (int j = -edge; j <= edge; ++j) {
+            // Columns of the region whose neighbor at offset j is inside the window.
+            int first = std::max(roi.col, halo.col - j);
+            int last = std::min(roi.col + roi.width, halo.col + halo.width - j);
+            if (first < last) {
+                const PixelT* src = &window[neighborRow * halo.width + (first + j - halo.col)];
+                convolve_row(&weightedSum[first - roi.col], src, kernel[(i + edge) * kernelSize + (j + edge)],
+                             sum, last - first);
+            }
+        }
+    }
+}
+
 // Mean Filter
-void Filter::apply_mean_filter(GrayscaleImage& image, int kernelSize) {
+template <typename PixelT>
+void Filter::apply_mean_filter(GrayscaleImageT<PixelT>& image, int kernelSize) {
+    Region full = {0, 0, image.get_height(), image.get_width()};
+    apply_mean_filter(image, image, full, kernelSize);
+}
+
+// Mean Filter restricted to a region
+template <typename PixelT>
+void Filter::apply_mean_filter(GrayscaleImageT<PixelT>& image, const Region& region, int kernelSize) {
+    apply_mean_filter(image, image, region, kernelSize);
+}
 
-    // 1. Copy the original image for reference.
-    GrayscaleImage copyImage = image;
+// Mean Filter from a source region into a target image
+template <typename PixelT>
+void Filter::apply_mean_filter(const GrayscaleImageT<PixelT>& source, GrayscaleImageT<PixelT>& target,
+                               const Region& region, int kernelSize) {
+    if (!same_size(source, target)) {
+        return;
+    }
 
-    // 2. For each pixel, calculate the mean value of its neighbors using a kernel.
-    int row = image.get_height();
-    int col = image.get_width();
+    int row = source.get_height();
+    int col = source.get_width();
 
     // Calculate the edge size of the kernel.
     int edge = (kernelSize-1) / 2;
 
-    // Iterate through each pixel in the image.
-    for (int r = 0; r < row; r++) {
-        for (int c = 0; c < col; c++) {
-            int sum = 0;
-            for (int i = -edge; i <= edge; i++) {
-                for (int j = -edge; j <= edge; j++) {
-                    int neighborRow = r + i;
-                    int neighborCol = c + j;
-
-                    // Check if the neighboring pixel is within the bounds of the image.
-                    if (neighborRow >= 0 && neighborRow < row &&
-                        neighborCol >= 0 && neighborCol < col) {
-
-                        // Add the value of the neighboring pixel to the sum.
-                        sum += copyImage.get_pixel(neighborRow, neighborCol);
-                        }
+    // 1. Copy the region and its kernel halo for reference, so the source may also be the target.
+    Region roi = region.clipped(row, col);
+    Region halo = halo_of(roi, edge, row, col);
+    std::vector<PixelT> window;
+    copy_region(source, halo, window);
+
+    // 2. For each pixel in the region, calculate the mean value of its neighbors using a kernel.
+    //    Column sums over the kernel rows slide down the region one row at a time, and the
+    //    window sum over the kernel columns slides along each row.
+    typedef typename PixelTraits<PixelT>::accum_type accum_type;
+    std::vector<accum_type> columnSum(halo.width, 0);
+    const PixelT* pixels = window.data();
+
+    for (int r = roi.row; r < roi.row + roi.height; r++) {
+        if (r == roi.row) {
+            for (int nr = std::max(r - edge, halo.row); nr < std::min(r + edge + 1, halo.row + halo.height); nr++) {
+                box_sum_row(columnSum.data(), pixels + (nr - halo.row) * halo.width, static_cast<const PixelT*>(nullptr), halo.width);
+            }
+        } else {
+            int entering = r + edge;
+            int leaving = r - edge - 1;
+            const PixelT* add = entering < halo.row + halo.height ? pixels + (entering - halo.row) * halo.width : nullptr;
+            const PixelT* sub = leaving >= halo.row ? pixels + (leaving - halo.row) * halo.width : nullptr;
+            if (add != nullptr || sub != nullptr) {
+                box_sum_row(columnSum.data(), add, sub, halo.width);
+            }
+        }
+
+        PixelT* out = target.get_data()[r];
+        accum_type sum = 0;
+        for (int nc = std::max(roi.col - edge, halo.col); nc < std::min(roi.col + edge + 1, halo.col + halo.width); nc++) {
+            sum += columnSum[nc - halo.col];
+        }
+        for (int c = roi.col; c < roi.col + roi.width; c++) {
+            if (c > roi.col) {
+                if (c + edge < halo.col + halo.width) {
+                    sum += columnSum[c + edge - halo.col];
+                }
+                if (c - edge - 1 >= halo.col) {
+                    sum -= columnSum[c - edge - 1 - halo.col];
                 }
             }
-            // Calculate the mean value by dividing the sum by the total number of pixels in the kernel.
-            int mean = sum / (kernelSize * kernelSize);
 
-            // 3. Update each pixel with the computed mean.
-            image.set_pixel(r, c, mean);
+            // 3. Divide the sum by the total number of pixels in the kernel and update each pixel with the mean.
+            out[c] = static_cast<PixelT>(sum / (kernelSize * kernelSize));
         }
     }
 }
 
 // Gaussian Smoothing Filter
-void Filter::apply_gaussian_smoothing(GrayscaleImage& image, int kernelSize, double sigma) {
+template <typename PixelT>
+void Filter::apply_gaussian_smoothing(GrayscaleImageT<PixelT>& image, int kernelSize, double sigma) {
+    Region full = {0, 0, image.get_height(), image.get_width()};
+    apply_gaussian_smoothing(image, image, full, kernelSize, sigma);
+}
 
-    int row = image.get_height();
-    int col = image.get_width();
+// Gaussian Smoothing Filter restricted to a region
+template <typename PixelT>
+void Filter::apply_gaussian_smoothing(GrayscaleImageT<PixelT>& image, const Region& region, int kernelSize, double sigma) {
+    apply_gaussian_smoothing(image, image, region, kernelSize, sigma);
+}
+
+// Gaussian Smoothing Filter from a source region into a target image
+template <typename PixelT>
+void Filter::apply_gaussian_smoothing(const GrayscaleImageT<PixelT>& source, GrayscaleImageT<PixelT>& target,
+                                      const Region& region, int kernelSize, double sigma) {
+    if (!same_size(source, target)) {
+        return;
+    }
+
+    int row = source.get_height();
+    int col = source.get_width();
     int edge = (kernelSize - 1) / 2;
-    double** kernel;
 
     // 1. Create a Gaussian kernel based on the given sigma value.
-    kernel = new double*[kernelSize];
-    for (int i = 0; i < kernelSize; i++) {
-        kernel[i] = new double[kernelSize];
-    }
+    std::vector<double> kernel;
+    double sum = build_gaussian_kernel(kernelSize, sigma, kernel);
 
-    double sum = 0.0;
+    // Copy the region and its halo to avoid modifying pixel values during calculation.
+    Region roi = region.clipped(row, col);
+    Region halo = halo_of(roi, edge, row, col);
+    std::vector<PixelT> window;
+    copy_region(source, halo, window);
 
-    // Calculate the values for the Gaussian kernel and keep track of their sum.
-    for (int x = -edge; x <= edge; ++x) {
-        for (int y = -edge; y <= edge; ++y) {
-            double exponent = -(x * x + y * y) / (2 * sigma * sigma);
-            kernel[x + edge][y + edge] = exp(exponent) / (2 * M_PI * sigma * sigma);
-            sum += kernel[x + edge][y + edge];
+    // 2. For each row of the region, compute the normalized weighted sums using the kernel.
+    std::vector<double> weightedSum;
+    for (int r = roi.row; r < roi.row + roi.height; ++r) {
+        gaussian_row(window, halo, roi, r, kernel, kernelSize, sum, weightedSum);
+
+        // 3. Update the pixel values with the smoothed results.
+        PixelT* out = target.get_data()[r] + roi.col;
+        for (int c = 0; c < roi.width; ++c) {
+            out[c] = static_cast<PixelT>(weightedSum[c]);
         }
     }
+}
 
-    // Make a copy of the original image to avoid modifying pixel values during calculation.
-    GrayscaleImage copyImage = image;
-
-    // 3. For each pixel, compute the weighted sum using the kernel.
-    for (int r = 0; r < row; ++r) {
-        for (int c = 0; c < col; ++c) {
-            double weightedSum = 0.0;
+// Unsharp Masking Filter
+template <typename PixelT>
+void Filter::apply_unsharp_mask(GrayscaleImageT<PixelT>& image, int kernelSize, double amount) {
+    Region full = {0, 0, image.get_height(), image.get_width()};
+    apply_unsharp_mask(image, image, full, kernelSize, amount);
+}
 
-            // Iterate through the kernel and calculate the weighted sum of neighbors.
-            for (int i = -edge; i <= edge; ++i) {
-                for (int j = -edge; j <= edge; ++j) {
-                    int neighborRow = r + i;
-                    int neighborCol = c + j;
+// Unsharp Masking Filter restricted to a region
+template <typename PixelT>
+void Filter::apply_unsharp_mask(GrayscaleImageT<PixelT>& image, const Region& region, int kernelSize, double amount) {
+    apply_unsharp_mask(image, image, region, kernelSize, amount);
+}
 
-                    // Ensure the neighboring pixel is within bounds.
-                    if (neighborRow >= 0 && neighborRow < row && neighborCol >= 0 && neighborCol < col) {
-                        weightedSum += copyImage.get_pixel(neighborRow, neighborCol) * kernel[i + edge][j + edge] / sum; // 2. Normalize the kernel to ensure it sums to 1.
-                    }
-                }
-            }
-            // 4. Update the pixel values with the smoothed results.
-            image.set_pixel(r, c, static_cast<int>(weightedSum));
-        }
+// Unsharp Masking Filter from a source region into a target image
+template <typename PixelT>
+void Filter::apply_unsharp_mask(const GrayscaleImageT<PixelT>& source, GrayscaleImageT<PixelT>& target,
+                                const Region& region, int kernelSize, double amount) {
+    if (!same_size(source, target)) {
+        return;
     }
 
-    // Free the allocated memory for the Gaussian kernel.
-    for (int i = 0; i < kernelSize; i++) {
-        delete[] kernel[i]; // Free each row of the kernel.
+    int row = source.get_height();
+    int col = source.get_width();
+    int edge = (kernelSize - 1) / 2;
+
+    // 1. Blur the region using Gaussian smoothing, use the default sigma given in the header.
+    //    Only the region and its halo are read, and the blur is computed one row at a time.
+    std::vector<double> kernel;
+    double sum = build_gaussian_kernel(kernelSize, 1, kernel);
+
+    Region roi = region.clipped(row, col);
+    Region halo = halo_of(roi, edge, row, col);
+    std::vector<PixelT> window;
+    copy_region(source, halo, window);
+
+    std::vector<double> blurred;
+    for (int r = roi.row; r < roi.row + roi.height; ++r) {
+        gaussian_row(window, halo, roi, r, kernel, kernelSize, sum, blurred);
+
+        // 2. For each pixel, apply the unsharp mask formula: original + amount * (original - blurred).
+        // 3. Clip values to ensure they are within the valid range of the pixel type, [0-255] for 8 bits.
+        const PixelT* original = &window[(r - halo.row) * halo.width + (roi.col - halo.col)];
+        unsharp_row(target.get_data()[r] + roi.col, original, blurred.data(), amount,
+                    static_cast<double>(PixelTraits<PixelT>::max_value()), roi.width);
     }
-    delete[] kernel; // Free the kernel pointer array itself.
 }
 
-// Unsharp Masking Filter
-void Filter::apply_unsharp_mask(GrayscaleImage& image, int kernelSize, double amount) {
-
-    // Create a copy of the original image to apply Gaussian smoothing.
-    GrayscaleImage gaussianImage = image;
+// Multi-scale Unsharp Masking Filter
+template <typename PixelT>
+void Filter::apply_multiscale_unsharp(GrayscaleImageT<PixelT>& image, const std::vector<double>& amounts,
+                                      int kernelSize, double sigma) {
+    GaussianPyramid pyramid(kernelSize, sigma);
+    apply_multiscale_unsharp(image, amounts, pyramid);
+}
 
-    // 1. Blur the image using Gaussian smoothing, use the default sigma given in the header.
-    apply_gaussian_smoothing(gaussianImage, kernelSize, 1);
+// Multi-scale Unsharp Masking Filter on a reusable pyramid
+template <typename PixelT>
+void Filter::apply_multiscale_unsharp(GrayscaleImageT<PixelT>& image, const std::vector<double>& amounts,
+                                      GaussianPyramid& pyramid) {
 
-    int row = image.get_height();
-    int col = image.get_width();
+    // 1. Build one level more than there are detail bands; small images may give fewer levels.
+    pyramid.build(image, static_cast<int>(amounts.size()) + 1);
+    int bands = pyramid.size() - 1;
+    if (bands <= 0) {
+        return;
+    }
 
-    // 2. For each pixel, apply the unsharp mask formula: original + amount * (original - blurred).
-    for (int r = 0; r < row; ++r) {
-        for (int c = 0; c < col; ++c) {
-            int originalPixel = image.get_pixel(r, c);
-            int gaussianPixel = gaussianImage.get_pixel(r, c);
+    // 2. Collapse from the coarsest band up: at each level, the enhancement carried up from below
+    //    plus amount * (level - expanded next level).
+    //    The expanded and enhancement images are the pyramid's scratch images for each level.
+    for (int l = bands - 1; l >= 0; --l) {
+        const GrayscaleImageT<float>& level = pyramid.level(l);
+        int w = level.get_width();
+        int h = level.get_height();
 
-            // 2. For each pixel, apply the unsharp mask formula: original + amount * (original - blurred).
-            double maskedPixel = originalPixel + amount * (originalPixel - gaussianPixel);
+        GrayscaleImageT<float>& expanded = pyramid.expanded(l);
+        GaussianPyramid::expand(pyramid.level(l + 1), expanded);
 
-            // 3. Clip values to ensure they are within a valid range [0-255].
-            if (maskedPixel > 255) {
-                maskedPixel = 255;
+        GrayscaleImageT<float>& carried = pyramid.enhancement(l);
+        if (l < bands - 1) {
+            GaussianPyramid::expand(pyramid.enhancement(l + 1), carried);
+        } else {
+            for (int r = 0; r < h; ++r) {
+                std::fill(carried.get_data()[r], carried.get_data()[r] + w, 0.0f);
             }
-            if (maskedPixel < 0) {
-                maskedPixel = 0;
+        }
+
+        float amount = static_cast<float>(amounts[l]);
+        for (int r = 0; r < h; ++r) {
+            const float* original = level.get_data()[r];
+            const float* blurred = expanded.get_data()[r];
+            float* out = carried.get_data()[r];
+            for (int c = 0; c < w; ++c) {
+                out[c] += amount * (original[c] - blurred[c]);
             }
-            image.set_pixel(r, c, static_cast<int>(maskedPixel));
         }
     }
-}
\ No newline at end of file
+    const GrayscaleImageT<float>& enhancement = pyramid.enhancement(0);
+
+    // 3. Add the enhancement to the image and clip values to the valid range of the pixel type.
+    double max_value = PixelTraits<PixelT>::max_value();
+    for (int r = 0; r < image.get_height(); ++r) {
+        PixelT* out = image.get_data()[r];
+        const float* detail = enhancement.get_data()[r];
+        for (int c = 0; c < image.get_width(); ++c) {
+            double maskedPixel = out[c] + static_cast<double>(detail[c]);
+            maskedPixel = std::min(std::max(maskedPixel, 0.0), max_value);
+            out[c] = static_cast<PixelT>(maskedPixel);
+        }
+    }
+}
+
+// Pixel types the filters are provided for.
+#define INSTANTIATE_FILTERS(PixelT) \
+    template void Filter::apply_mean_filter<PixelT>(GrayscaleImageT<PixelT>&, int); \
+    template void Filter::apply_gaussian_smoothing<PixelT>(GrayscaleImageT<PixelT>&, int, double); \
+    template void Filter::apply_unsharp_mask<PixelT>(GrayscaleImageT<PixelT>&, int, double); \
+    template void Filter::apply_mean_filter<PixelT>(GrayscaleImageT<PixelT>&, const Region&, int); \
+    template void Filter::apply_gaussian_smoothing<PixelT>(GrayscaleImageT<PixelT>&, const Region&, int, double); \
+    template void Filter::apply_unsharp_mask<PixelT>(GrayscaleImageT<PixelT>&, const Region&, int, double); \
+    template void Filter::apply_mean_filter<PixelT>(const GrayscaleImageT<PixelT>&, GrayscaleImageT<PixelT>&, \
+                                                    const Region&, int); \
+    template void Filter::apply_gaussian_smoothing<PixelT>(const GrayscaleImageT<PixelT>&, GrayscaleImageT<PixelT>&, \
+                                                           const Region&, int, double); \
+    template void Filter::apply_unsharp_mask<PixelT>(const GrayscaleImageT<PixelT>&, GrayscaleImageT<PixelT>&, \
+                                                     const Region&, int, double); \
+    template void Filter::apply_multiscale_unsharp<PixelT>(GrayscaleImageT<PixelT>&, const std::vector<double>&, \
+                                                           int, double); \
+    template void Filter::apply_multiscale_unsharp<PixelT>(GrayscaleImageT<PixelT>&, const std::vector<double>&, \
+                                                           GaussianPyramid&);
+
+INSTANTIATE_FILTERS(uint8_t)
+INSTANTIATE_FILTERS(uint16_t)
+INSTANTIATE_FILTERS(int)
+INSTANTIATE_FILTERS(float)
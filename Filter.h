@@ -2,18 +2,58 @@
 #define FILTER_H
 
 #include "GrayscaleImage.h"
+#include "GaussianPyramid.h"
+#include <vector>
 
+// Filters are templated on the pixel type and provided for uint8_t, uint16_t, int and float images.
 class Filter {
 
 public:
     // Apply the Mean Filter
-    static void apply_mean_filter(GrayscaleImage& image, int kernelSize = 3);
+    template <typename PixelT>
+    static void apply_mean_filter(GrayscaleImageT<PixelT>& image, int kernelSize = 3);
 
     // Apply Gaussian Smoothing Filter
-    static void apply_gaussian_smoothing(GrayscaleImage& image, int kernelSize = 3, double sigma = 1.0);
+    template <typename PixelT>
+    static void apply_gaussian_smoothing(GrayscaleImageT<PixelT>& image, int kernelSize = 3, double sigma = 1.0);
 
     // Apply Unsharp Masking Filter
-    static void apply_unsharp_mask(GrayscaleImage& image, int kernelSize = 3, double amount = 1.5);
+    template <typename PixelT>
+    static void apply_unsharp_mask(GrayscaleImageT<PixelT>& image, int kernelSize = 3, double amount = 1.5);
+
+    // Region-of-interest variants: only pixels inside the region are updated,
+    // and only the region plus the kernel halo around it is read.
+    template <typename PixelT>
+    static void apply_mean_filter(GrayscaleImageT<PixelT>& image, const Region& region, int kernelSize = 3);
+    template <typename PixelT>
+    static void apply_gaussian_smoothing(GrayscaleImageT<PixelT>& image, const Region& region,
+                                         int kernelSize = 3, double sigma = 1.0);
+    template <typename PixelT>
+    static void apply_unsharp_mask(GrayscaleImageT<PixelT>& image, const Region& region,
+                                   int kernelSize = 3, double amount = 1.5);
+
+    // Re-filter a region of an unmodified source image into a target image of the same size,
+    // e.g. to try new parameters on a region without touching the rest of the frame.
+    template <typename PixelT>
+    static void apply_mean_filter(const GrayscaleImageT<PixelT>& source, GrayscaleImageT<PixelT>& target,
+                                  const Region& region, int kernelSize = 3);
+    template <typename PixelT>
+    static void apply_gaussian_smoothing(const GrayscaleImageT<PixelT>& source, GrayscaleImageT<PixelT>& target,
+                                         const Region& region, int kernelSize = 3, double sigma = 1.0);
+    template <typename PixelT>
+    static void apply_unsharp_mask(const GrayscaleImageT<PixelT>& source, GrayscaleImageT<PixelT>& target,
+                                   const Region& region, int kernelSize = 3, double amount = 1.5);
+
+    // Apply multi-scale Unsharp Masking: amounts[l] scales the detail between pyramid levels l and l + 1,
+    // so the image is sharpened at amounts.size() scales while coarse detail is computed on reduced levels.
+    template <typename PixelT>
+    static void apply_multiscale_unsharp(GrayscaleImageT<PixelT>& image, const std::vector<double>& amounts,
+                                         int kernelSize = 5, double sigma = 1.0);
+
+    // Same, reusing the level buffers of a pyramid across calls
+    template <typename PixelT>
+    static void apply_multiscale_unsharp(GrayscaleImageT<PixelT>& image, const std::vector<double>& amounts,
+                                         GaussianPyramid& pyramid);
 
 };
 
@@ -0,0 +1,132 @@
+#include "GaussianPyramid.h"
+#include <algorithm>
+#include <cmath>
+
+
+// Constructor: build the normalized 1D Gaussian kernel
+GaussianPyramid::GaussianPyramid(int kernelSize, double sigma) : level_count(0) {
+    int edge = (kernelSize - 1) / 2;
+    taps.resize(2 * edge + 1);
+
+    double sum = 0.0;
+    for (int x = -edge; x <= edge; ++x) {
+        taps[x + edge] = static_cast<float>(std::exp(-(x * x) / (2 * sigma * sigma)));
+        sum += taps[x + edge];
+    }
+    for (float& tap : taps) {
+        tap = static_cast<float>(tap / sum);
+    }
+}
+
+// Make sure an image has the given size, reallocating only when it changed.
+static void ensure_size(GrayscaleImageT<float>& image, int w, int h) {
+    if (image.get_width() != w || image.get_height() != h) {
+        image = GrayscaleImageT<float>(w, h);
+    }
+}
+
+// Build the pyramid levels from an image
+template <typename PixelT>
+void GaussianPyramid::build(const GrayscaleImageT<PixelT>& image, int count) {
+    int w = image.get_width();
+    int h = image.get_height();
+
+    level_count = 0;
+    if (count <= 0) {
+        return;
+    }
+    while (static_cast<int>(levels.size()) < count) {
+        levels.push_back(GrayscaleImageT<float>(0, 0));
+        expanded_levels.push_back(GrayscaleImageT<float>(0, 0));
+        enhancement_levels.push_back(GrayscaleImageT<float>(0, 0));
+    }
+
+    // 1. Level 0 is the image itself, converted to float.
+    ensure_size(levels[0], w, h);
+    for (int r = 0; r < h; ++r) {
+        const PixelT* src = image.get_data()[r];
+        float* dst = levels[0].get_data()[r];
+        for (int c = 0; c < w; ++c) {
+            dst[c] = static_cast<float>(src[c]);
+        }
+    }
+
+    // 2. Every further level halves the previous one, rounding up, until it can't shrink anymore.
+    level_count = 1;
+    while (level_count < count && w > 1 && h > 1) {
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+        ensure_size(levels[level_count], w, h);
+        reduce(levels[level_count - 1], levels[level_count]);
+        level_count++;
+    }
+
+    // 3. Size the scratch images to match the levels.
+    for (int l = 0; l < level_count; ++l) {
+        ensure_size(expanded_levels[l], levels[l].get_width(), levels[l].get_height());
+        ensure_size(enhancement_levels[l], levels[l].get_width(), levels[l].get_height());
+    }
+}
+
+// Separable blur with edge pixels repeated, evaluated only at the even rows and columns that are kept
+void GaussianPyramid::reduce(const GrayscaleImageT<float>& fine, GrayscaleImageT<float>& coarse) {
+    int fw = fine.get_width();
+    int fh = fine.get_height();
+    int cw = coarse.get_width();
+    int ch = coarse.get_height();
+    int edge = static_cast<int>(taps.size() / 2);
+
+    // 1. Horizontal pass over every row, at the kept columns only.
+    scratch.resize(static_cast<size_t>(fh) * cw);
+    for (int r = 0; r < fh; ++r) {
+        const float* src = fine.get_data()[r];
+        float* dst = &scratch[static_cast<size_t>(r) * cw];
+        for (int c = 0; c < cw; ++c) {
+            float sum = 0.0f;
+            for (int j = -edge; j <= edge; ++j) {
+                int x = std::min(std::max(2 * c + j, 0), fw - 1);
+                sum += taps[j + edge] * src[x];
+            }
+            dst[c] = sum;
+        }
+    }
+
+    // 2. Vertical pass at the kept rows, one whole row of taps at a time.
+    for (int r = 0; r < ch; ++r) {
+        float* dst = coarse.get_data()[r];
+        std::fill(dst, dst + cw, 0.0f);
+        for (int i = -edge; i <= edge; ++i) {
+            int y = std::min(std::max(2 * r + i, 0), fh - 1);
+            const float* src = &scratch[static_cast<size_t>(y) * cw];
+            float weight = taps[i + edge];
+            for (int c = 0; c < cw; ++c) {
+                dst[c] += weight * src[c];
+            }
+        }
+    }
+}
+
+// Bilinear upsampling: even fine pixels copy their coarse sample, odd ones average two
+void GaussianPyramid::expand(const GrayscaleImageT<float>& coarse, GrayscaleImageT<float>& fine) {
+    int cw = coarse.get_width();
+    int ch = coarse.get_height();
+    int fw = fine.get_width();
+    int fh = fine.get_height();
+
+    for (int r = 0; r < fh; ++r) {
+        const float* top = coarse.get_data()[std::min(r / 2, ch - 1)];
+        const float* bottom = coarse.get_data()[std::min((r + 1) / 2, ch - 1)];
+        float* dst = fine.get_data()[r];
+        for (int c = 0; c < fw; ++c) {
+            int left = std::min(c / 2, cw - 1);
+            int right = std::min((c + 1) / 2, cw - 1);
+            dst[c] = 0.25f * (top[left] + top[right] + bottom[left] + bottom[right]);
+        }
+    }
+}
+
+// Pixel types a pyramid can be built from.
+template void GaussianPyramid::build<uint8_t>(const GrayscaleImageT<uint8_t>&, int);
+template void GaussianPyramid::build<uint16_t>(const GrayscaleImageT<uint16_t>&, int);
+template void GaussianPyramid::build<int>(const GrayscaleImageT<int>&, int);
+template void GaussianPyramid::build<float>(const GrayscaleImageT<float>&, int);
@@ -0,0 +1,47 @@
+#ifndef GAUSSIAN_PYRAMID_H
+#define GAUSSIAN_PYRAMID_H
+
+#include "GrayscaleImage.h"
+#include <vector>
+
+// Gaussian pyramid of float images: level 0 is the source image and each following level is
+// the previous one blurred with a separable Gaussian and downsampled by 2 in both directions.
+// Level images and scratch buffers are kept between builds and reused while the sizes match.
+class GaussianPyramid {
+private:
+    std::vector<GrayscaleImageT<float> > levels;
+    std::vector<GrayscaleImageT<float> > expanded_levels;    // Scratch images sized like each level
+    std::vector<GrayscaleImageT<float> > enhancement_levels;
+    std::vector<float> taps;    // Normalized 1D Gaussian kernel
+    std::vector<float> scratch; // Horizontally blurred and decimated rows of the level being reduced
+    int level_count;
+
+    // Blur a level and keep every second row and column.
+    void reduce(const GrayscaleImageT<float>& fine, GrayscaleImageT<float>& coarse);
+
+public:
+    // Constructor: separable kernel of the given size and sigma
+    GaussianPyramid(int kernelSize = 5, double sigma = 1.0);
+
+    // Build up to `count` levels from an image, stopping early once a level is a single pixel wide or high.
+    // Provided for uint8_t, uint16_t, int and float images.
+    template <typename PixelT>
+    void build(const GrayscaleImageT<PixelT>& image, int count);
+
+    // Number of levels of the last build
+    int size() const { return level_count; }
+
+    // Get a level, 0 being full resolution
+    const GrayscaleImageT<float>& level(int index) const { return levels[index]; }
+
+    // Scratch images the size of a level, kept across builds like the levels themselves,
+    // for filters that expand and accumulate while collapsing the pyramid
+    GrayscaleImageT<float>& expanded(int index) { return expanded_levels[index]; }
+    GrayscaleImageT<float>& enhancement(int index) { return enhancement_levels[index]; }
+
+    // Upsample an image to the size of `fine` by bilinear interpolation between the samples
+    // that reduce kept (fine pixel 2i comes from coarse pixel i).
+    static void expand(const GrayscaleImageT<float>& coarse, GrayscaleImageT<float>& fine);
+};
+
+#endif // GAUSSIAN_PYRAMID_H
@@ -6,82 +6,127 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 #include <stdexcept>
+#include <string>
 
 
-// Constructor: load from a file
-GrayscaleImage::GrayscaleImage(const char* filename) {
+// Allocate one contiguous block for all pixels and point each row into it.
+template <typename PixelT>
+void GrayscaleImageT<PixelT>::allocate() {
+    data = new PixelT*[height];
+    if (height > 0) {
+        PixelT* pixels = new PixelT[static_cast<size_t>(width) * height];
+        for (int i = 0; i < height; i++) {
+            data[i] = pixels + static_cast<size_t>(i) * width;
+        }
+    }
+}
 
-    // Image loading code using stbi
-    int channels;
-    unsigned char* image = stbi_load(filename, &width, &height, &channels, STBI_grey);
+// Free the pixel block and the row pointers.
+template <typename PixelT>
+void GrayscaleImageT<PixelT>::release() {
+    if (data != nullptr) {
+        if (height > 0) {
+            delete[] data[0];
+        }
+        delete[] data;
+        data = nullptr;
+    }
+}
 
-    if (image == nullptr) {
+// Constructor: load from a file
+template <typename PixelT>
+GrayscaleImageT<PixelT>::GrayscaleImageT(const char* filename) : data(nullptr), width(0), height(0) {
+    if (!load_pixels(filename)) {
         std::cerr << "Error: Could not load image " << filename << std::endl;
         exit(1);
     }
+}
 
-    // Dynamically allocate memory for a 2D matrix based on the given dimensions.
-    data = new int*[height];
-    for (int i = 0; i < height; i++) {
-        data[i] = new int[width];
+// Load an image from a file, throwing instead of exiting when it can't be decoded
+template <typename PixelT>
+GrayscaleImageT<PixelT> GrayscaleImageT<PixelT>::load(const char* filename) {
+    GrayscaleImageT image(0, 0);
+    if (!image.load_pixels(filename)) {
+        throw std::runtime_error(std::string("Could not load image ") + filename);
     }
+    return image;
+}
+
+// Replace the pixels with those of an image file
+template <typename PixelT>
+bool GrayscaleImageT<PixelT>::load_pixels(const char* filename) {
+
+    // Image loading code using stbi, at 16 bits per pixel for 16-bit pixel types
+    int w, h, channels;
+    void* image;
+    if (PixelTraits<PixelT>::bit_depth == 16) {
+        image = stbi_load_16(filename, &w, &h, &channels, STBI_grey);
+    } else {
+        image = stbi_load(filename, &w, &h, &channels, STBI_grey);
+    }
+
+    if (image == nullptr) {
+        return false;
+    }
+
+    // Dynamically allocate memory for a 2D matrix based on the given dimensions.
+    release();
+    width = w;
+    height = h;
+    allocate();
 
     // Fill the matrix with pixel values from the image
     for (int row = 0; row < height; row++) {
         for (int col = 0; col < width; col++) {
             int index = (width * row) + col;
-            unsigned char pixel_value = image[index];
-            data[row][col] = static_cast<int>(pixel_value);
+            if (PixelTraits<PixelT>::bit_depth == 16) {
+                data[row][col] = static_cast<PixelT>(static_cast<stbi_us*>(image)[index]);
+            } else {
+                data[row][col] = static_cast<PixelT>(static_cast<unsigned char*>(image)[index]);
+            }
         }
     }
 
     // Free the dynamically allocated memory of stbi image
     stbi_image_free(image);
+    return true;
 }
 
 // Constructor: initialize from a pre-existing data matrix
-GrayscaleImage::GrayscaleImage(int** inputData, int h, int w) {
+template <typename PixelT>
+GrayscaleImageT<PixelT>::GrayscaleImageT(PixelT** inputData, int h, int w) {
 
     // Initialize the image with a pre-existing data matrix by copying the values.
-    // Don't forget to dynamically allocate memory for the matrix.
 
     // Set height and width of the image.
     height = h;
     width = w;
 
     // Allocate dynamic memory for a 2D matrix.
-    data = new int*[height];
-    for (int i = 0; i < height; i++) {
-        data[i] = new int[width];
-    }
+    allocate();
 
     // Copy the values from the input data matrix to the new matrix.
     for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            data[row][col] = inputData[row][col];
-        }
+        std::memcpy(data[row], inputData[row], sizeof(PixelT) * width);
     }
 }
 
 // Constructor to create a blank image of given width and height
-GrayscaleImage::GrayscaleImage(int w, int h) : width(w), height(h) {
+template <typename PixelT>
+GrayscaleImageT<PixelT>::GrayscaleImageT(int w, int h) : width(w), height(h) {
 
     // Just dynamically allocate the memory for the new matrix.
-    data = new int*[height];
-    for (int i = 0; i < height; i++) {
-        data[i] = new int[width];
-    }
+    allocate();
 
     // Initialize all pixels to 0 to create a blank image
     for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            data[row][col] = 0;
-        }
+        std::fill(data[row], data[row] + width, PixelT());
     }
 }
 
 // Copy constructor
-GrayscaleImage::GrayscaleImage(const GrayscaleImage& other) {
+template <typename PixelT>
+GrayscaleImageT<PixelT>::GrayscaleImageT(const GrayscaleImageT& other) {
 
     // Copy constructor: dynamically allocate memory and
     // copy pixel values from another image.
@@ -89,31 +134,62 @@ GrayscaleImage::GrayscaleImage(const GrayscaleImage& other) {
     width = other.width;
     height = other.height;
 
-    data = new int*[height];
-    for (int i = 0; i < height; i++) {
-        data[i] = new int[width];
-    }
-
+    allocate();
     for (int row = 0; row < height; row++) {
-        for (int col = 0; col < width; col++) {
-            data[row][col] = other.data[row][col];
-        }
+        std::memcpy(data[row], other.data[row], sizeof(PixelT) * width);
     }
 }
 
+// Move constructor: take over the pixel block of another image
+template <typename PixelT>
+GrayscaleImageT<PixelT>::GrayscaleImageT(GrayscaleImageT&& other)
+    : data(other.data), width(other.width), height(other.height) {
+    other.data = nullptr;
+    other.width = 0;
+    other.height = 0;
+}
+
 // Destructor: Free dynamically allocated memory for matrix
-GrayscaleImage::~GrayscaleImage() {
+template <typename PixelT>
+GrayscaleImageT<PixelT>::~GrayscaleImageT() {
+    release();
+}
 
-    // Destructor: deallocate memory for the matrix.
+// Copy assignment: reuse the pixel block when the dimensions match
+template <typename PixelT>
+GrayscaleImageT<PixelT>& GrayscaleImageT<PixelT>::operator=(const GrayscaleImageT& other) {
+    if (this != &other) {
+        if (width != other.width || height != other.height) {
+            release();
+            width = other.width;
+            height = other.height;
+            allocate();
+        }
+        for (int row = 0; row < height; row++) {
+            std::memcpy(data[row], other.data[row], sizeof(PixelT) * width);
+        }
+    }
+    return *this;
+}
 
-    for (int i = 0; i < height; i++) {
-        delete[] data[i];
+// Move assignment
+template <typename PixelT>
+GrayscaleImageT<PixelT>& GrayscaleImageT<PixelT>::operator=(GrayscaleImageT&& other) {
+    if (this != &other) {
+        release();
+        data = other.data;
+        width = other.width;
+        height = other.height;
+        other.data = nullptr;
+        other.width = 0;
+        other.height = 0;
     }
-    delete[] data;
+    return *this;
 }
 
 // Equality operator
-bool GrayscaleImage::operator==(const GrayscaleImage& other) const {
+template <typename PixelT>
+bool GrayscaleImageT<PixelT>::operator==(const GrayscaleImageT& other) const {
 
     // Check if two images have the same dimensions and pixel values.
     // If they do, return true.
@@ -129,67 +205,74 @@ bool GrayscaleImage::operator==(const GrayscaleImage& other) const {
 }
 
 // Addition operator
-GrayscaleImage GrayscaleImage::operator+(const GrayscaleImage& other) const {
+template <typename PixelT>
+GrayscaleImageT<PixelT> GrayscaleImageT<PixelT>::operator+(const GrayscaleImageT& other) const {
+    typedef typename PixelTraits<PixelT>::accum_type accum_type;
 
     // Create a new image for the result
-    GrayscaleImage result(width, height);
+    GrayscaleImageT result(width, height);
 
     // Add two images' pixel values and return a new image, clamping the results.
 
     for (int row = 0; row < height; row++) {
         for (int col = 0; col < width; col++) {
-            int sum = data[row][col] + other.data[row][col];
-            if (sum > 255) {
-                sum = 255;
+            accum_type sum = static_cast<accum_type>(data[row][col]) + other.data[row][col];
+            if (sum > PixelTraits<PixelT>::max_value()) {
+                sum = PixelTraits<PixelT>::max_value();
             } else if (sum < 0) {
                 sum = 0;
             }
-            result.set_pixel(row, col, sum);
+            result.set_pixel(row, col, static_cast<PixelT>(sum));
         }
     }
     return result;
 }
 
 // Subtraction operator
-GrayscaleImage GrayscaleImage::operator-(const GrayscaleImage& other) const {
+template <typename PixelT>
+GrayscaleImageT<PixelT> GrayscaleImageT<PixelT>::operator-(const GrayscaleImageT& other) const {
+    typedef typename PixelTraits<PixelT>::accum_type accum_type;
 
     // Create a new image for the result
-    GrayscaleImage result(width, height);
+    GrayscaleImageT result(width, height);
 
     // Subtract pixel values of two images and return a new image, clamping the results.
     for (int row = 0; row < height; row++) {
         for (int col = 0; col < width; col++) {
-            int diff = data[row][col] - other.data[row][col] ;
-            if (diff > 255) {
-                diff = 255;
+            accum_type diff = static_cast<accum_type>(data[row][col]) - other.data[row][col];
+            if (diff > PixelTraits<PixelT>::max_value()) {
+                diff = PixelTraits<PixelT>::max_value();
             } else if (diff < 0) {
                 diff = 0;
             }
-            result.set_pixel(row, col, diff);
+            result.set_pixel(row, col, static_cast<PixelT>(diff));
         }
     }
     return result;
 }
 
 // Get a specific pixel value
-int GrayscaleImage::get_pixel(int row, int col) const {
+template <typename PixelT>
+PixelT GrayscaleImageT<PixelT>::get_pixel(int row, int col) const {
     return data[row][col];
 }
 
 // Set a specific pixel value
-void GrayscaleImage::set_pixel(int row, int col, int value) {
+template <typename PixelT>
+void GrayscaleImageT<PixelT>::set_pixel(int row, int col, PixelT value) {
     data[row][col] = value;
 }
 
 // Function to save the image to a PNG file
-void GrayscaleImage::save_to_file(const char* filename) const {
+template <typename PixelT>
+void GrayscaleImageT<PixelT>::save_to_file(const char* filename) const {
     // Create a buffer to hold the image data in the format stb_image_write expects
     unsigned char* imageBuffer = new unsigned char[width * height];
 
-    // Fill the buffer with pixel data (convert int to unsigned char)
+    // Fill the buffer with pixel data (16-bit pixels keep their high byte)
     for (int i = 0; i < height; ++i) {
         for (int j = 0; j < width; ++j) {
-            imageBuffer[i * width + j] = static_cast<unsigned char>(data[i][j]);
+            imageBuffer[i * width + j] = PixelTraits<PixelT>::to_byte(data[i][j]);
         }
     }
 
@@ -201,3 +284,9 @@ void GrayscaleImage::save_to_file(const char* filename) const {
     // Clean up the allocated buffer
     delete[] imageBuffer;
 }
+
+// Pixel types the image is provided for.
+template class GrayscaleImageT<uint8_t>;
+template class GrayscaleImageT<uint16_t>;
+template class GrayscaleImageT<int>;
+template class GrayscaleImageT<float>;
@@ -1,50 +1,175 @@
 #ifndef GRAYSCALE_IMAGE_H
 #define GRAYSCALE_IMAGE_H
 
-class GrayscaleImage {
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+// Rectangular region of an image in pixel coordinates.
+struct Region {
+    int row, col;
+    int height, width;
+
+    // Returns the part of this region that lies inside an image of the given size.
+    Region clipped(int h, int w) const {
+        int top = std::max(row, 0);
+        int left = std::max(col, 0);
+        int bottom = std::min(row + height, h);
+        int right = std::min(col + width, w);
+        return Region{top, left, std::max(bottom - top, 0), std::max(right - left, 0)};
+    }
+};
+
+// Per pixel type properties: the type sums are accumulated in, the largest
+// valid pixel value, the bit depth loaded from file and the 8-bit value written back.
+template <typename PixelT>
+struct PixelTraits;
+
+template <>
+struct PixelTraits<uint8_t> {
+    typedef int accum_type;
+    static const int bit_depth = 8;
+    static uint8_t max_value() { return 255; }
+    static unsigned char to_byte(uint8_t value) { return value; }
+};
+
+template <>
+struct PixelTraits<uint16_t> {
+    typedef long long accum_type;
+    static const int bit_depth = 16;
+    static uint16_t max_value() { return 65535; }
+    static unsigned char to_byte(uint16_t value) { return static_cast<unsigned char>(value >> 8); }
+};
+
+template <>
+struct PixelTraits<int> {
+    typedef int accum_type;
+    static const int bit_depth = 8;
+    static int max_value() { return 255; }
+    static unsigned char to_byte(int value) { return static_cast<unsigned char>(value); }
+};
+
+// Float images are intermediates and carry values on the 8-bit scale.
+template <>
+struct PixelTraits<float> {
+    typedef double accum_type;
+    static const int bit_depth = 8;
+    static float max_value() { return 255.0f; }
+    static unsigned char to_byte(float value) {
+        return static_cast<unsigned char>(std::min(std::max(value, 0.0f), 255.0f));
+    }
+};
+
+// Grayscale image stored as one contiguous row-major block of pixels,
+// with row pointers into it. Instantiated for uint8_t, uint16_t, int and float.
+template <typename PixelT>
+class GrayscaleImageT {
 private:
-    int** data;
+    PixelT** data;
     int width, height;
 
+    // Allocate the pixel block and row pointers for the current dimensions.
+    void allocate();
+
+    // Free the pixel block and row pointers.
+    void release();
+
+    // Replace the pixels with those of an image file; returns false if it can't be loaded.
+    bool load_pixels(const char* filename);
 
 public:
-    // Constructor: loads an image from a file
-    GrayscaleImage(const char* filename);
+    typedef PixelT pixel_type;
+
+    // Constructor: loads an image from a file, exiting if it can't be loaded
+    GrayscaleImageT(const char* filename);
+
+    // Loads an image from a file, throwing std::runtime_error if it can't be loaded
+    static GrayscaleImageT load(const char* filename);
 
     // Constructor: initializes from a 2D data matrix
-    GrayscaleImage(int** inputData, int h, int w);
+    GrayscaleImageT(PixelT** inputData, int h, int w);
 
     // Constructor to create a blank image of given width and height
-    GrayscaleImage(int w, int h);
+    GrayscaleImageT(int w, int h);
 
     // Copy constructor
-    GrayscaleImage(const GrayscaleImage& other);
+    GrayscaleImageT(const GrayscaleImageT& other);
+
+    // Move constructor
+    GrayscaleImageT(GrayscaleImageT&& other);
+
+    // Converting constructor from an image of another pixel type
+    template <typename OtherT>
+    explicit GrayscaleImageT(const GrayscaleImageT<OtherT>& other);
 
     // Destructor
-    ~GrayscaleImage();
+    ~GrayscaleImageT();
+
+    // Assignment operators
+    GrayscaleImageT& operator=(const GrayscaleImageT& other);
+    GrayscaleImageT& operator=(GrayscaleImageT&& other);
 
     // Operator overloads
-    bool operator==(const GrayscaleImage& other) const;
-    GrayscaleImage operator+(const GrayscaleImage& other) const;
-    GrayscaleImage operator-(const GrayscaleImage& other) const;
+    bool operator==(const GrayscaleImageT& other) const;
+    GrayscaleImageT operator+(const GrayscaleImageT& other) const;
+    GrayscaleImageT operator-(const GrayscaleImageT& other) const;
 
     // Method to get image dimensions
     int get_width() const { return width; }
     int get_height() const { return height; }
 
     // Get a specific pixel value
-    int get_pixel(int row, int col) const;
+    PixelT get_pixel(int row, int col) const;
 
     // Set a specific pixel value
-    void set_pixel(int row, int col, int value);
+    void set_pixel(int row, int col, PixelT value);
 
     // Function to write the image data back to a PNG file
     void save_to_file(const char* filename) const;
 
     // Getter function for data.
-    int** get_data() const {
+    PixelT** get_data() const {
         return data;
     }
 };
 
+// Convert one pixel value to another pixel type. Conversions into an integer pixel type clamp the
+// value to [0, max_value()], with NaN becoming 0. Going from 16-bit to an 8-bit type keeps the high
+// byte first, as save_to_file does; going from 8 to 16 bits keeps the value as it is.
+template <typename PixelT, typename OtherT>
+inline PixelT convert_pixel(OtherT value) {
+    if (std::is_floating_point<PixelT>::value) {
+        return static_cast<PixelT>(value);
+    }
+    double converted = static_cast<double>(value);
+    if (PixelTraits<OtherT>::bit_depth == 16 && PixelTraits<PixelT>::bit_depth == 8) {
+        converted = std::floor(converted / 256.0);
+    }
+    double max_value = static_cast<double>(PixelTraits<PixelT>::max_value());
+    if (!(converted > 0.0)) {
+        converted = 0.0;
+    } else if (converted > max_value) {
+        converted = max_value;
+    }
+    return static_cast<PixelT>(converted);
+}
+
+// Converting constructor: copy pixel values, converting each to this pixel type.
+template <typename PixelT>
+template <typename OtherT>
+GrayscaleImageT<PixelT>::GrayscaleImageT(const GrayscaleImageT<OtherT>& other)
+    : width(other.get_width()), height(other.get_height()) {
+    allocate();
+    OtherT** source = other.get_data();
+    for (int row = 0; row < height; row++) {
+        for (int col = 0; col < width; col++) {
+            data[row][col] = convert_pixel<PixelT>(source[row][col]);
+        }
+    }
+}
+
+// The original int image type used throughout the library.
+typedef GrayscaleImageT<int> GrayscaleImage;
+
 #endif // GRAYSCALE_IMAGE_H
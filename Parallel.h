@@ -0,0 +1,66 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Parallel {
+public:
+    // Number of worker threads to use when the caller passes 0.
+    static int default_threads() {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        return hardware == 0 ? 1 : static_cast<int>(hardware);
+    }
+
+    // Call fn(i) for every i in [0, count) on up to `threads` threads (0 for one per core).
+    // Indices are handed out dynamically; the first exception thrown by fn is rethrown here
+    // once all workers have stopped.
+    template <typename Fn>
+    static void for_each_index(int count, Fn fn, int threads = 0) {
+        if (count <= 0) {
+            return;
+        }
+        if (threads <= 0) {
+            threads = default_threads();
+        }
+        threads = std::min(threads, count);
+
+        std::atomic<int> next(0);
+        std::exception_ptr error;
+        std::mutex error_mutex;
+
+        auto worker = [&]() {
+            for (int i = next++; i < count; i = next++) {
+                try {
+                    fn(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    next = count;
+                }
+            }
+        };
+
+        // The calling thread works as well, so a single thread runs inline.
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads; ++t) {
+            pool.push_back(std::thread(worker));
+        }
+        worker();
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+#endif // PARALLEL_H
@@ -1,4 +1,10 @@
 #include "SecretImage.h"
+#include "Parallel.h"
+#include "DatCodec.h"
+#include <memory>
+
+// Pixels per block of rows, so one block of both the image and the arrays stays cache sized.
+static const int BLOCK_PIXELS = 1 << 18;
 
 
 // Constructor: split image into upper and lower triangular arrays
@@ -6,32 +12,21 @@ SecretImage::SecretImage(const GrayscaleImage& image) {
     width = image.get_width();
     height = image.get_height();
 
-    int row = image.get_height();
-    int col = image.get_width();
-    int upper_size = col * (col+1) /2;
-    int lower_size = col * (col-1) /2;
-
     // 1. Dynamically allocate the memory for the upper and lower triangular matrices.
-    upper_triangular = new int[upper_size];
-    lower_triangular = new int[lower_size];
-
-    int upper_index = 0;
-    int low_index = 0;
-
-    // 2. Fill both matrices with the pixels from the GrayscaleImage.
-    for (int m=0; m< row; m++) {
-        for (int n=0; n< col; n++) {
-            if (m<= n) {
-                upper_triangular[upper_index] = image.get_pixel(m, n);
-                upper_index++;
-            }
-            else {
-                lower_triangular[low_index] = image.get_pixel(m, n);
-                low_index++;
-            }
-
+    upper_triangular = new int[upper_size()];
+    lower_triangular = new int[lower_size()];
+
+    // 2. Fill both matrices with the pixels from the GrayscaleImage: each row is one contiguous
+    //    run into the lower array followed by one into the upper array.
+    int rows = block_rows();
+    Parallel::for_each_index((height + rows - 1) / rows, [&](int block) {
+        for (int m = block * rows; m < std::min((block + 1) * rows, height); m++) {
+            const int* pixels = image.get_data()[m];
+            int diagonal = std::min(m, width);
+            std::copy(pixels, pixels + diagonal, lower_triangular + lower_offset(m));
+            std::copy(pixels + diagonal, pixels + width, upper_triangular + upper_offset(m));
         }
-    }
+    });
 }
 
 // Constructor: instantiate based on data read from file
@@ -44,6 +39,28 @@ SecretImage::SecretImage(int w, int h, int * upper, int * lower) {
     lower_triangular =lower;
 }
 
+// Copy constructor: copy both triangular arrays
+SecretImage::SecretImage(const SecretImage& other) {
+    width = other.width;
+    height = other.height;
+    upper_triangular = new int[upper_size()];
+    lower_triangular = new int[lower_size()];
+    std::copy(other.upper_triangular, other.upper_triangular + upper_size(), upper_triangular);
+    std::copy(other.lower_triangular, other.lower_triangular + lower_size(), lower_triangular);
+}
+
+// Move constructor: take over the arrays of another secret image
+SecretImage::SecretImage(SecretImage&& other) {
+    width = other.width;
+    height = other.height;
+    upper_triangular = other.upper_triangular;
+    lower_triangular = other.lower_triangular;
+    other.upper_triangular = nullptr;
+    other.lower_triangular = nullptr;
+    other.width = 0;
+    other.height = 0;
+}
+
 // Destructor: free the arrays
 SecretImage::~SecretImage() {
 
@@ -54,67 +71,57 @@ SecretImage::~SecretImage() {
     delete[] lower_triangular;
 }
 
+// Copy assignment: copy both triangular arrays
+SecretImage& SecretImage::operator=(const SecretImage& other) {
+    if (this != &other) {
+        SecretImage copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+// Move assignment: free the current arrays and take over those of another secret image
+SecretImage& SecretImage::operator=(SecretImage&& other) {
+    if (this != &other) {
+        delete[] upper_triangular;
+        delete[] lower_triangular;
+        width = other.width;
+        height = other.height;
+        upper_triangular = other.upper_triangular;
+        lower_triangular = other.lower_triangular;
+        other.upper_triangular = nullptr;
+        other.lower_triangular = nullptr;
+        other.width = 0;
+        other.height = 0;
+    }
+    return *this;
+}
+
 // Reconstructs and returns the full image from upper and lower triangular matrices.
 GrayscaleImage SecretImage::reconstruct() const {
     GrayscaleImage image(width, height);
 
-    // Initialize indices to track positions in the upper and lower triangular arrays.
-    int upper_index = 0;
-    int lower_index = 0;
-
-    // Calculate the sizes of the upper and lower triangular arrays.
-    int upper_size = width * (width + 1) / 2;
-    int lower_size = width * (width - 1) / 2;
-
-    int size = image.get_height();
-
-    int row = 0;
-    int col = 0;
-
-    // Initialize current_n to keep track of how many pixels to set from the upper triangular array.
-    int current_n = size;
-
-    // Used to track how many pixels to set from the lower triangular array.
-    int lower_increment= 1;
-
-    // Loop until all pixels from the upper and lower triangular arrays have been placed in the image.
-    while (current_n >0 && upper_index < upper_size && row <size) {
-
-        // Fill pixels from the upper triangular matrix.
-        for (int i =0; i < current_n && upper_index < upper_size && row < size; ++i) {
-            // If the current column reaches the image width, move to the next row.
-            if (col == size ) {
-                row++;
-                col = 0;
-            }
-            // Set pixels from the upper triangular array to the image if still within bounds.
-            if (row < size) {
-                int upper_set = upper_triangular[upper_index++];
-                image.set_pixel(row, col++, upper_set);
-            }
+    // Copy each row back from its run in the lower array and its run in the upper array.
+    int rows = block_rows();
+    Parallel::for_each_index((height + rows - 1) / rows, [&](int block) {
+        for (int m = block * rows; m < std::min((block + 1) * rows, height); m++) {
+            int* pixels = image.get_data()[m];
+            int diagonal = std::min(m, width);
+            const int* lower = lower_triangular + lower_offset(m);
+            const int* upper = upper_triangular + upper_offset(m);
+            std::copy(lower, lower + diagonal, pixels);
+            std::copy(upper, upper + (width - diagonal), pixels + diagonal);
         }
+    });
+    return image;
+}
 
-        // Fill pixels from the lower triangular matrix.
-        for (int j = 0; j < lower_increment && lower_index < lower_size && row < size; ++j) {
-            // If the current column reaches the image width, move to the next row.
-            if (col == size ) {
-                row++;
-                col = 0;
-            }
-            // Set pixels from the lower triangular array to the image if still within bounds.
-            if (row < size) {
-                int lower_set = lower_triangular[lower_index++];
-                image.set_pixel(row, col++, lower_set);
-            }
-        }
-
-        // Decrease the number of pixels to set from the upper triangular matrix for the next row.
-        current_n--;
-
-        // Increase the number of pixels to set from the lower triangular matrix.
-        lower_increment++;
+// Reads one pixel from the triangular arrays without reconstructing the image
+int SecretImage::get_pixel(int row, int col) const {
+    if (row <= col) {
+        return upper_triangular[upper_offset(row) + (col - row)];
     }
-    return image;
+    return lower_triangular[lower_offset(row) + col];
 }
 
 // Save the filtered image back to the triangular arrays
@@ -122,35 +129,37 @@ void SecretImage::save_back(const GrayscaleImage& image) {
 
     // Update the lower and upper triangular matrices
     // based on the GrayscaleImage given as the parameter.
+    Region full = {0, 0, height, width};
+    save_back(image, full);
+}
 
-    // Get the height and width of the input image
-    int row = image.get_height();
-    int col = image.get_width();
-
-    // Calculate the sizes of the upper and lower triangular matrices
-    int upper_size = col * (col + 1) / 2;
-    int lower_size = col * (col - 1) / 2;
-
-    // Initialize indices for tracking positions in the triangular matrices
-    int upper_index = 0;
-    int low_index = 0;
-
-    // Iterate through each pixel of the input image
-    for (int m = 0; m < row; m++) {
-        for (int n = 0; n < col; n++) {
-            // Check if the current pixel belongs to the upper triangular part
-            if (m <= n && upper_index < upper_size) {
-                // Update upper triangular matrix
-                upper_triangular[upper_index] = image.get_pixel(m, n);
-                upper_index++;
-            }
-            // Check if the current pixel belongs to the lower triangular part
-            else if (low_index < lower_size) {
-                // Update lower triangular matrix
-                lower_triangular[low_index] = image.get_pixel(m, n);
-                low_index++;
-            }
+// Save only the pixels inside a region back to the triangular arrays
+void SecretImage::save_back(const GrayscaleImage& image, const Region& region) {
+
+    // 1. Clip the region to both this secret image and the given image.
+    Region roi = region.clipped(std::min(height, image.get_height()), std::min(width, image.get_width()));
+
+    int rows = block_rows();
+    Parallel::for_each_index((roi.height + rows - 1) / rows, [&](int block) {
+        int first_row = roi.row + block * rows;
+        for (int m = first_row; m < std::min(first_row + rows, roi.row + roi.height); m++) {
+            const int* pixels = image.get_data()[m];
+            int first = roi.col;
+            int last = roi.col + roi.width;
+
+            // 2. Columns left of the diagonal go to the lower triangular array,
+            //    columns on or right of it to the upper triangular array.
+            int diagonal = std::min(std::max(m, first), last);
+            std::copy(pixels + first, pixels + diagonal, lower_triangular + lower_offset(m) + first);
+            std::copy(pixels + diagonal, pixels + last, upper_triangular + upper_offset(m) + (diagonal - m));
         }
+    });
+}
+
+// Save each dirty region back to the triangular arrays
+void SecretImage::save_back(const GrayscaleImage& image, const std::vector<Region>& regions) {
+    for (const Region& region : regions) {
+        save_back(image, region);
     }
 }
 
@@ -165,23 +174,19 @@ void SecretImage::save_to_file(const std::string& filename) {
         // 1. Write width and height on the first line, separated by a single space.
         outfile << get_width() << " " << get_height() << std::endl;
 
-        int upper_size = width * (width + 1) / 2;
-
         // 2. Write the upper_triangular array to the second line.
-        for (int i = 0; i < upper_size; i++) {
+        for (int i = 0; i < upper_size(); i++) {
             outfile << upper_triangular[i]; // Write each element of the upper triangular array
-            if (i < upper_size - 1) { // If it's not the last element, add a space
+            if (i < upper_size() - 1) { // If it's not the last element, add a space
                 outfile << " ";
             }
         }
         outfile << std::endl;
 
-        int lower_size = width * (width - 1) / 2;
-
         // 3. Write the lower_triangular array to the third line in a similar manner as the second line.
-        for (int i = 0; i < lower_size; i++) {
+        for (int i = 0; i < lower_size(); i++) {
             outfile << lower_triangular[i];
-            if (i < lower_size - 1) {
+            if (i < lower_size() - 1) {
                 outfile << " ";
             }
         }
@@ -190,30 +195,56 @@ void SecretImage::save_to_file(const std::string& filename) {
     }
 }
 
+// Save the triangular arrays to a file in the compressed format
+void SecretImage::save_to_compressed_file(const std::string& filename) {
+    std::ofstream outfile(filename, std::ios::binary);
+    if (!outfile.is_open()) {
+        throw std::runtime_error("Could not open " + filename + " for writing");
+    }
+    DatCodec::write(outfile, width, height, upper_triangular, upper_size(), lower_triangular, lower_size());
+    if (!outfile) {
+        throw std::runtime_error("Could not write " + filename);
+    }
+}
+
 // Static function to load a SecretImage from a file
 SecretImage SecretImage::load_from_file(const std::string& filename) {
 
-    // 1. Open the file and read width and height from the first line, separated by a space.
-    std::ifstream infile(filename);
+    // 1. Open the file; compressed files are recognized by their header and decoded by DatCodec.
+    //    Otherwise read width and height from the first line, separated by a space.
+    std::ifstream infile(filename, std::ios::binary);
 
     int width = 0, height = 0;
+    if (DatCodec::is_compressed(infile)) {
+        DatCodec::read_header(infile, width, height);
+        int upper_count = upper_size(width, height);
+        int lower_count = lower_size(width, height);
+        std::unique_ptr<int[]> upper(new int[upper_count]);
+        std::unique_ptr<int[]> lower(new int[lower_count]);
+        DatCodec::read_arrays(infile, upper.get(), upper_count, lower.get(), lower_count);
+        return SecretImage(width, height, upper.release(), lower.release());
+    }
+
     infile >> width >> height;
+    if (width < 0 || height < 0 || static_cast<long long>(width) * height > std::numeric_limits<int>::max()) {
+        throw std::runtime_error("Invalid image size in " + filename);
+    }
 
     // 2. Calculate the sizes of the upper and lower triangular arrays.
-    int upper_size = width * (width + 1) / 2;
-    int lower_size = width * (width - 1) / 2;
+    int upper_count = upper_size(width, height);
+    int lower_count = lower_size(width, height);
 
     // 3. Allocate memory for both arrays.
-    int* upper_triangular = new int[upper_size];
-    int* lower_triangular = new int[lower_size];
+    int* upper_triangular = new int[upper_count];
+    int* lower_triangular = new int[lower_count];
 
     // 4. Read the upper_triangular array from the second line, space-separated.
-    for (int i = 0; i < upper_size; ++i) {
+    for (int i = 0; i < upper_count; ++i) {
         infile >> upper_triangular[i];
     }
 
     // 5. Read the lower_triangular array from the third line, space-separated.
-    for (int i = 0; i < lower_size; ++i) {
+    for (int i = 0; i < lower_count; ++i) {
         infile >> lower_triangular[i];
     }
 
@@ -226,6 +257,48 @@ SecretImage SecretImage::load_from_file(const std::string& filename) {
 }
 
 
+// Returns the number of entries in the upper triangular array (including the diagonal)
+// of a w x h image: the first min(w, h) rows hold w, w - 1, ... entries.
+int SecretImage::upper_size(int w, int h) {
+    long long rows = std::min(w, h);
+    return static_cast<int>(rows * w - rows * (rows - 1) / 2);
+}
+
+// Returns the number of entries in the lower triangular array (excluding the diagonal),
+// all pixels that are not in the upper one.
+int SecretImage::lower_size(int w, int h) {
+    return static_cast<int>(static_cast<long long>(w) * h - upper_size(w, h));
+}
+
+int SecretImage::upper_size() const {
+    return upper_size(width, height);
+}
+
+int SecretImage::lower_size() const {
+    return lower_size(width, height);
+}
+
+// Returns the index of the first upper triangular entry of the given row:
+// rows above it hold width, width - 1, ... entries, and rows past the width hold none.
+int SecretImage::upper_offset(int row) const {
+    int rows = std::min(row, width);
+    return rows * width - rows * (rows - 1) / 2;
+}
+
+// Returns the index of the first lower triangular entry of the given row:
+// rows above it hold 0, 1, ... entries, and rows past the width hold width entries each.
+int SecretImage::lower_offset(int row) const {
+    if (row <= width) {
+        return row * (row - 1) / 2;
+    }
+    return width * (width - 1) / 2 + (row - width) * width;
+}
+
+// Returns the number of rows in a block of about BLOCK_PIXELS pixels.
+int SecretImage::block_rows() const {
+    return std::max(1, BLOCK_PIXELS / std::max(width, 1));
+}
+
 // Returns a pointer to the upper triangular part of the secret image.
 int * SecretImage::get_upper_triangular() const {
     return upper_triangular;
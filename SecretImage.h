@@ -8,6 +8,7 @@
 #include <sstream>
 #include <string>
 #include <limits>
+#include <vector>
 
 #include "GrayscaleImage.h"
 
@@ -18,6 +19,20 @@ private:
     int *lower_triangular; // Array for lower triangular part (excluding diagonal)
     int width, height;
 
+    // Number of entries in the upper and lower triangular arrays of a w x h image.
+    static int upper_size(int w, int h);
+    static int lower_size(int w, int h);
+    int upper_size() const;
+    int lower_size() const;
+
+    // Index of the first entry of a row in the upper and lower triangular arrays.
+    // Row m holds columns [min(m, width), width) in the upper array and [0, min(m, width)) in the lower one.
+    int upper_offset(int row) const;
+    int lower_offset(int row) const;
+
+    // Number of rows copied together: blocks of rows are split, reconstructed and saved back in parallel.
+    int block_rows() const;
+
 public:
     // Constructor: takes a GrayscaleImage and splits it into two triangular arrays
     SecretImage(const GrayscaleImage &image);
@@ -25,19 +40,39 @@ public:
     // Constructor: instantiate based on data read from file
     SecretImage(int w, int h, int *upper, int *lower);
 
+    // Copy constructor: copies both triangular arrays
+    SecretImage(const SecretImage &other);
+
+    // Move constructor: takes over the triangular arrays
+    SecretImage(SecretImage &&other);
+
     // Destructor
     ~SecretImage();
 
+    // Assignment operators
+    SecretImage &operator=(const SecretImage &other);
+    SecretImage &operator=(SecretImage &&other);
+
     // Function to reconstruct the image from two arrays
     GrayscaleImage reconstruct() const;
 
+    // Read a single pixel straight from the triangular arrays
+    int get_pixel(int row, int col) const;
+
     // Save back to triangular arrays after filtering
     void save_back(const GrayscaleImage &image);
 
+    // Save back only the pixels inside a region, or inside each of a list of dirty regions
+    void save_back(const GrayscaleImage &image, const Region &region);
+    void save_back(const GrayscaleImage &image, const std::vector<Region> &regions);
+
     // Saves a secret image into the given file
     void save_to_file(const std::string &filename);
 
-    // Reads a secret image from the given file
+    // Saves a secret image into the given file in the compressed .dat format (see DatCodec.h)
+    void save_to_compressed_file(const std::string &filename);
+
+    // Reads a secret image from the given file, in either the text or the compressed format
     static SecretImage load_from_file(const std::string &filename);
 
     // Getters and setters for private instance variables
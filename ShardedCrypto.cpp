@@ -0,0 +1,185 @@
+#include "ShardedCrypto.h"
+#include "Parallel.h"
+#include <memory>
+
+
+// Append a 32-bit value to a byte string, most significant byte first.
+static void append_u32(std::string& bytes, unsigned int value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        bytes += static_cast<char>((value >> shift) & 0xFF);
+    }
+}
+
+// Read a 32-bit value from a byte string at the given offset, most significant byte first.
+static unsigned int read_u32(const std::string& bytes, size_t offset) {
+    unsigned int value = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        value = (value << 8) | static_cast<unsigned char>(bytes[offset + i]);
+    }
+    return value;
+}
+
+// CRC-32 with the reflected IEEE polynomial, table driven
+unsigned int ShardedCrypto::crc32(const std::string& bytes) {
+    static const std::vector<unsigned int> table = []() {
+        std::vector<unsigned int> entries(256);
+        for (unsigned int n = 0; n < 256; ++n) {
+            unsigned int c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+
+    unsigned int crc = 0xFFFFFFFFu;
+    for (char byte : bytes) {
+        crc = table[(crc ^ static_cast<unsigned char>(byte)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Payload bytes a cover can hold after its shard header, or -1 if not even the header fits
+static long long shard_capacity(const GrayscaleImage& cover, int bits_per_pixel) {
+    long long capacity = Crypto::payload_capacity(cover.get_width(), cover.get_height(), bits_per_pixel);
+    return capacity - ShardedCrypto::SHARD_HEADER_BYTES;
+}
+
+// Total payload bytes all covers can hold
+long long ShardedCrypto::total_capacity(const std::vector<GrayscaleImage>& covers, int bits_per_pixel) {
+    long long total = 0;
+    for (const GrayscaleImage& cover : covers) {
+        total += std::max(shard_capacity(cover, bits_per_pixel), 0LL);
+    }
+    return total;
+}
+
+// Split the payload across the covers and embed the shards in parallel
+std::vector<SecretImage> ShardedCrypto::embed_sharded(std::vector<GrayscaleImage>& covers, const std::string& payload,
+                                                      int bits_per_pixel, int threads) {
+
+    int count = static_cast<int>(covers.size());
+    long long length = static_cast<long long>(payload.size());
+
+    // 1. Ensure the covers can hold the whole payload, else throw an error.
+    if (count == 0) {
+        throw std::invalid_argument("No cover images given");
+    }
+    if (bits_per_pixel < 1 || bits_per_pixel > Crypto::MAX_BITS_PER_PIXEL) {
+        throw std::invalid_argument("Bits per pixel must be between 1 and 4");
+    }
+    for (const GrayscaleImage& cover : covers) {
+        if (shard_capacity(cover, bits_per_pixel) < 0) {
+            throw std::invalid_argument("Cover image is too small to hold a shard header");
+        }
+    }
+    long long total = total_capacity(covers, bits_per_pixel);
+    if (length > total || length > 0xFFFFFFFFLL) {
+        throw std::length_error("Cover images can't hold the payload");
+    }
+
+    // 2. Give every cover a chunk in proportion to its capacity, then hand out
+    //    the rounding remainder to covers that still have room.
+    std::vector<long long> offsets(count + 1, 0);
+    std::vector<long long> sizes(count, 0);
+    long long assigned = 0;
+    for (int i = 0; i < count; ++i) {
+        long long capacity = shard_capacity(covers[i], bits_per_pixel);
+        sizes[i] = total > 0 ? length * capacity / total : 0;
+        assigned += sizes[i];
+    }
+    for (int i = 0; i < count && assigned < length; ++i) {
+        long long extra = std::min(shard_capacity(covers[i], bits_per_pixel) - sizes[i], length - assigned);
+        sizes[i] += extra;
+        assigned += extra;
+    }
+    for (int i = 0; i < count; ++i) {
+        offsets[i + 1] = offsets[i] + sizes[i];
+    }
+
+    // 3. Prefix each chunk with its shard header and embed the shards in parallel.
+    std::vector<std::unique_ptr<SecretImage> > embedded(count);
+    Parallel::for_each_index(count, [&](int i) {
+        std::string chunk = payload.substr(offsets[i], sizes[i]);
+
+        std::string shard;
+        shard.reserve(SHARD_HEADER_BYTES + chunk.size());
+        append_u32(shard, static_cast<unsigned int>(i));
+        append_u32(shard, static_cast<unsigned int>(count));
+        append_u32(shard, static_cast<unsigned int>(length));
+        append_u32(shard, crc32(chunk));
+        shard += chunk;
+
+        embedded[i].reset(new SecretImage(Crypto::embed_payload(covers[i], shard, bits_per_pixel)));
+    }, threads);
+
+    // 4. Return the secret images in cover order.
+    std::vector<SecretImage> shards;
+    shards.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        shards.push_back(std::move(*embedded[i]));
+    }
+    return shards;
+}
+
+// Extract the shards in parallel, check them and put the payload back together
+std::string ShardedCrypto::extract_sharded(const std::vector<SecretImage>& shards, int threads) {
+
+    int count = static_cast<int>(shards.size());
+    if (count == 0) {
+        throw std::invalid_argument("No shards given");
+    }
+
+    // 1. Extract every shard and verify its header and checksum.
+    std::vector<std::string> chunks(count);
+    std::vector<unsigned int> indices(count), counts(count), lengths(count);
+    Parallel::for_each_index(count, [&](int i) {
+        std::string shard = Crypto::extract_payload(shards[i]);
+        if (shard.size() < static_cast<size_t>(SHARD_HEADER_BYTES)) {
+            throw std::runtime_error("Shard is too short to hold a shard header");
+        }
+        indices[i] = read_u32(shard, 0);
+        counts[i] = read_u32(shard, 4);
+        lengths[i] = read_u32(shard, 8);
+        chunks[i] = shard.substr(SHARD_HEADER_BYTES);
+        if (crc32(chunks[i]) != read_u32(shard, 12)) {
+            throw std::runtime_error("Shard " + std::to_string(indices[i]) + " failed its integrity check");
+        }
+    }, threads);
+
+    // 2. Ensure the shards form one complete, consistent set.
+    for (int i = 0; i < count; ++i) {
+        if (counts[i] != counts[0] || lengths[i] != lengths[0]) {
+            throw std::runtime_error("Shards do not belong to the same payload");
+        }
+    }
+    if (counts[0] != static_cast<unsigned int>(count)) {
+        std::string got = "(got " + std::to_string(count) + " of " + std::to_string(counts[0]) + ")";
+        if (static_cast<unsigned int>(count) < counts[0]) {
+            throw std::runtime_error("Missing shards " + got);
+        }
+        throw std::runtime_error("More shards than the payload was split into " + got);
+    }
+
+    std::vector<int> order(count, -1);
+    long long assembled = 0;
+    for (int i = 0; i < count; ++i) {
+        if (indices[i] >= static_cast<unsigned int>(count) || order[indices[i]] != -1) {
+            throw std::runtime_error("Shard index is out of range or duplicated");
+        }
+        order[indices[i]] = i;
+        assembled += static_cast<long long>(chunks[i].size());
+    }
+    if (assembled != static_cast<long long>(lengths[0])) {
+        throw std::runtime_error("Shard sizes do not add up to the payload length");
+    }
+
+    // 3. Concatenate the chunks in shard index order.
+    std::string payload;
+    payload.reserve(assembled);
+    for (int index = 0; index < count; ++index) {
+        payload += chunks[order[index]];
+    }
+    return payload;
+}
@@ -0,0 +1,32 @@
+#ifndef SHARDED_CRYPTO_H
+#define SHARDED_CRYPTO_H
+
+#include "Crypto.h"
+#include <string>
+#include <vector>
+
+// Splits a payload too large for one cover image across several covers.
+// Each cover receives one shard, embedded as a framed Crypto payload that starts with
+// a SHARD_HEADER_BYTES header: shard index, shard count, total payload length and
+// CRC-32 of the chunk, each 32 bits, most significant byte first.
+class ShardedCrypto {
+public:
+    static const int SHARD_HEADER_BYTES = 16;
+
+    // Number of payload bytes the covers can hold together at the given bits per pixel
+    static long long total_capacity(const std::vector<GrayscaleImage>& covers, int bits_per_pixel = 1);
+
+    // Split the payload over all covers in proportion to their capacity and embed the shards
+    // in parallel on up to `threads` threads (0 for one per core). Throws if the payload does not fit.
+    static std::vector<SecretImage> embed_sharded(std::vector<GrayscaleImage>& covers, const std::string& payload,
+                                                  int bits_per_pixel = 1, int threads = 0);
+
+    // Extract the shards in parallel, verify each checksum and reassemble the payload.
+    // Shards may be passed in any order; throws if a shard is missing, duplicated or corrupt.
+    static std::string extract_sharded(const std::vector<SecretImage>& shards, int threads = 0);
+
+    // CRC-32 (IEEE 802.3 polynomial) of a byte string
+    static unsigned int crc32(const std::string& bytes);
+};
+
+#endif // SHARDED_CRYPTO_H
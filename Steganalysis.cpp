@@ -0,0 +1,321 @@
+#include "Steganalysis.h"
+#include "CpuDispatch.h"
+#include "Parallel.h"
+#include "stb_image.h"
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+// Rows per band handed to one thread.
+static const int BAND_ROWS = 64;
+
+// Number of set bits in a 64-bit word; compiles to popcnt inside the popcnt-enabled variants.
+STEGA_KERNEL_BODY int popcount64(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    word = word - ((word >> 1) & 0x5555555555555555ULL);
+    word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Index of the lowest set bit of a non-zero word.
+static inline int count_trailing_zeros(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int count = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Pack kernel: the LSB of pixel x becomes bit x % 64 of word x / 64; unused tail bits are 0.
+template <typename PixelT>
+STEGA_KERNEL_BODY void pack_lsb_row_body(const PixelT* pixels, uint64_t* words, int n) {
+    int full = n / 64;
+    for (int w = 0; w < full; ++w) {
+        uint64_t word = 0;
+        for (int b = 0; b < 64; ++b) {
+            word |= static_cast<uint64_t>(pixels[w * 64 + b] & 1) << b;
+        }
+        words[w] = word;
+    }
+    if (n % 64 != 0) {
+        uint64_t word = 0;
+        for (int b = 0; b < n % 64; ++b) {
+            word |= static_cast<uint64_t>(pixels[full * 64 + b] & 1) << b;
+        }
+        words[full] = word;
+    }
+}
+
+// Transition kernel: bit x is set where the LSBs of pixels x and x + 1 differ.
+STEGA_KERNEL_BODY void lsb_transitions_row_body(const uint64_t* words, uint64_t* transitions, int n) {
+    int count = (n + 63) / 64;
+    if (count == 0) {
+        return;
+    }
+    for (int w = 0; w + 1 < count; ++w) {
+        transitions[w] = words[w] ^ ((words[w] >> 1) | (words[w + 1] << 63));
+    }
+    // The last pixel has no right neighbor.
+    int last_bits = (n - 1) % 64;
+    uint64_t keep = last_bits == 0 ? 0 : ~0ULL >> (64 - last_bits);
+    transitions[count - 1] = (words[count - 1] ^ (words[count - 1] >> 1)) & keep;
+}
+
+// Popcount kernel: total set bits over a run of words.
+STEGA_KERNEL_BODY void popcount_words_body(const uint64_t* words, int count, long long* total) {
+    long long sum = 0;
+    for (int w = 0; w < count; ++w) {
+        sum += popcount64(words[w]);
+    }
+    *total = sum;
+}
+
+template <typename PixelT>
+STEGA_KERNEL_VARIANTS(PackLsbRow, (pack_lsb_row_body<PixelT>), (const PixelT* pixels, uint64_t* words, int n),
+                      (pixels, words, n));
+STEGA_KERNEL_VARIANTS(LsbTransitionsRow, lsb_transitions_row_body,
+                      (const uint64_t* words, uint64_t* transitions, int n), (words, transitions, n));
+STEGA_KERNEL_VARIANTS(PopcountWords, popcount_words_body, (const uint64_t* words, int count, long long* total),
+                      (words, count, total));
+
+// Dispatchers: each picks its variant for the active instruction set level on first use.
+template <typename PixelT>
+static void pack_lsb_row(const PixelT* pixels, uint64_t* words, int n) {
+    typedef void (*Fn)(const PixelT*, uint64_t*, int);
+    static const Fn kernel = CpuDispatch::select<PackLsbRow<PixelT>, Fn>();
+    kernel(pixels, words, n);
+}
+
+static void lsb_transitions_row(const uint64_t* words, uint64_t* transitions, int n) {
+    typedef void (*Fn)(const uint64_t*, uint64_t*, int);
+    static const Fn kernel = CpuDispatch::select<LsbTransitionsRow, Fn>();
+    kernel(words, transitions, n);
+}
+
+static long long popcount_words(const uint64_t* words, int count) {
+    typedef void (*Fn)(const uint64_t*, int, long long*);
+    static const Fn kernel = CpuDispatch::select<PopcountWords, Fn>();
+    long long total = 0;
+    kernel(words, count, &total);
+    return total;
+}
+
+// Accumulate the histogram, transitions and run lengths of rows [first, last) into stats.
+template <typename PixelT>
+static void analyze_rows(const GrayscaleImageT<PixelT>& image, int first, int last, LSBStats& stats) {
+    int width = image.get_width();
+    int count = (width + 63) / 64;
+    std::vector<uint64_t> words(count), transitions(count);
+
+    for (int r = first; r < last; ++r) {
+        const PixelT* row = image.get_data()[r];
+
+        // 1. Histogram of the low 8 bits.
+        for (int x = 0; x < width; ++x) {
+            stats.histogram[static_cast<int>(row[x]) & 0xFF]++;
+        }
+
+        // 2. Pack the LSB plane and count where neighboring LSBs differ.
+        pack_lsb_row(row, words.data(), width);
+        lsb_transitions_row(words.data(), transitions.data(), width);
+        stats.lsb_transitions += popcount_words(transitions.data(), count);
+
+        // 3. Each transition ends a run of equal LSBs; the last run ends at the end of the row.
+        int start = 0;
+        for (int w = 0; w < count; ++w) {
+            for (uint64_t bits = transitions[w]; bits != 0; bits &= bits - 1) {
+                int end = w * 64 + count_trailing_zeros(bits) + 1;
+                stats.run_lengths[std::min(end - start, static_cast<int>(LSBStats::MAX_RUN_LENGTH))]++;
+                start = end;
+            }
+        }
+        if (width > start) {
+            stats.run_lengths[std::min(width - start, static_cast<int>(LSBStats::MAX_RUN_LENGTH))]++;
+        }
+    }
+}
+
+// Natural log of the gamma function at a = twice_a / 2, exact for the half-integers
+// that chi-square degrees of freedom produce.
+static double log_gamma_half(int twice_a) {
+    double result = 0.0;
+    if (twice_a % 2 == 0) {
+        // Gamma(n) = (n - 1)!
+        for (int k = 2; k < twice_a / 2; ++k) {
+            result += std::log(static_cast<double>(k));
+        }
+    } else {
+        // Gamma(n + 1/2) = sqrt(pi) * (1/2) * (3/2) * ... * (n - 1/2)
+        result = 0.5 * std::log(M_PI);
+        for (int k = 0; k < twice_a / 2; ++k) {
+            result += std::log(k + 0.5);
+        }
+    }
+    return result;
+}
+
+// Upper tail probability of a chi-square statistic, the regularized incomplete gamma Q(dof / 2, x / 2),
+// by its series below the mean and its continued fraction above.
+static double chi_square_upper_tail(double statistic, int dof) {
+    if (dof <= 0 || statistic <= 0) {
+        return 1.0;
+    }
+    double a = dof / 2.0;
+    double x = statistic / 2.0;
+    double prefix = std::exp(-x + a * std::log(x) - log_gamma_half(dof));
+
+    if (x < a + 1) {
+        double term = 1.0 / a;
+        double sum = term;
+        for (int n = 1; n < 1000 && std::fabs(term) > std::fabs(sum) * 1e-15; ++n) {
+            term *= x / (a + n);
+            sum += term;
+        }
+        return std::max(0.0, 1.0 - prefix * sum);
+    }
+
+    const double tiny = 1e-300;
+    double b = x + 1 - a;
+    double c = 1 / tiny;
+    double d = 1 / b;
+    double h = d;
+    for (int i = 1; i < 1000; ++i) {
+        double an = -i * (i - a);
+        b += 2;
+        d = an * d + b;
+        d = std::fabs(d) < tiny ? tiny : d;
+        c = b + an / c;
+        c = std::fabs(c) < tiny ? tiny : c;
+        d = 1 / d;
+        double delta = d * c;
+        h *= delta;
+        if (std::fabs(delta - 1) < 1e-15) {
+            break;
+        }
+    }
+    return prefix * h;
+}
+
+// Derive bit planes, the pairs-of-values chi-square and the run length entropy from the counts.
+static void finish_stats(LSBStats& stats) {
+
+    // 1. Bit plane populations from the histogram.
+    for (int value = 0; value < 256; ++value) {
+        for (int plane = 0; plane < 8; ++plane) {
+            if ((value >> plane) & 1) {
+                stats.bit_plane_ones[plane] += stats.histogram[value];
+            }
+        }
+    }
+
+    // 2. Pairs of values: LSB embedding evens out the counts of 2k and 2k + 1. Only pairs
+    //    with an expected count of at least 5 take part.
+    stats.chi_square = 0.0;
+    int pairs = 0;
+    for (int k = 0; k < 128; ++k) {
+        double expected = (stats.histogram[2 * k] + stats.histogram[2 * k + 1]) / 2.0;
+        if (expected >= 5) {
+            double difference = stats.histogram[2 * k] - expected;
+            stats.chi_square += difference * difference / expected;
+            pairs++;
+        }
+    }
+    stats.degrees_of_freedom = std::max(pairs - 1, 0);
+    stats.embedding_probability = pairs > 1 ? chi_square_upper_tail(stats.chi_square, stats.degrees_of_freedom) : 0.0;
+
+    // 3. Shannon entropy of the run length distribution.
+    long long runs = 0;
+    for (int length = 1; length <= LSBStats::MAX_RUN_LENGTH; ++length) {
+        runs += stats.run_lengths[length];
+    }
+    stats.run_length_entropy = 0.0;
+    for (int length = 1; length <= LSBStats::MAX_RUN_LENGTH; ++length) {
+        if (stats.run_lengths[length] > 0) {
+            double p = static_cast<double>(stats.run_lengths[length]) / runs;
+            stats.run_length_entropy -= p * std::log2(p);
+        }
+    }
+}
+
+// Analyze row bands in parallel and reduce their counts
+template <typename PixelT>
+LSBStats Steganalysis::analyze(const GrayscaleImageT<PixelT>& image, int threads) {
+    int height = image.get_height();
+    int bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+
+    // 1. Count each band separately.
+    std::vector<LSBStats> partial(bands, LSBStats());
+    Parallel::for_each_index(bands, [&](int band) {
+        int first = band * BAND_ROWS;
+        analyze_rows(image, first, std::min(first + BAND_ROWS, height), partial[band]);
+    }, threads);
+
+    // 2. Sum the band counts.
+    LSBStats stats = LSBStats();
+    stats.width = image.get_width();
+    stats.height = height;
+    for (const LSBStats& band : partial) {
+        for (int value = 0; value < 256; ++value) {
+            stats.histogram[value] += band.histogram[value];
+        }
+        for (int length = 0; length <= LSBStats::MAX_RUN_LENGTH; ++length) {
+            stats.run_lengths[length] += band.run_lengths[length];
+        }
+        stats.lsb_transitions += band.lsb_transitions;
+    }
+
+    // 3. Derive the statistics.
+    finish_stats(stats);
+    return stats;
+}
+
+// Analyze many files, each on a single thread
+std::vector<LSBStats> Steganalysis::scan_files(const std::vector<std::string>& filenames, int threads) {
+    std::vector<LSBStats> results(filenames.size(), LSBStats());
+    Parallel::for_each_index(static_cast<int>(filenames.size()), [&](int i) {
+        // 16-bit files are analyzed at full depth, since an 8-bit load would keep only their high byte.
+        try {
+            const char* filename = filenames[i].c_str();
+            if (stbi_is_16_bit(filename)) {
+                results[i] = analyze(GrayscaleImageT<uint16_t>::load(filename), 1);
+            } else {
+                results[i] = analyze(GrayscaleImageT<uint8_t>::load(filename), 1);
+            }
+        } catch (const std::runtime_error& error) {
+            results[i].error = error.what();
+        }
+    }, threads);
+    return results;
+}
+
+// One tab-separated line: name, size, LSB ratio, chi-square, degrees of freedom,
+// embedding probability, LSB transition ratio and run length entropy
+void Steganalysis::write_report(std::ostream& out, const std::string& name, const LSBStats& stats) {
+    if (!stats.error.empty()) {
+        out << name << "\terror\t" << stats.error << '\n';
+        return;
+    }
+    double pixels = static_cast<double>(stats.width) * stats.height;
+    double neighbors = static_cast<double>(stats.width - 1) * stats.height;
+    out << name << '\t' << stats.width << 'x' << stats.height
+        << '\t' << (pixels > 0 ? stats.bit_plane_ones[0] / pixels : 0.0)
+        << '\t' << stats.chi_square
+        << '\t' << stats.degrees_of_freedom
+        << '\t' << stats.embedding_probability
+        << '\t' << (neighbors > 0 ? stats.lsb_transitions / neighbors : 0.0)
+        << '\t' << stats.run_length_entropy << '\n';
+}
+
+// Pixel types the analysis is provided for.
+template LSBStats Steganalysis::analyze<uint8_t>(const GrayscaleImageT<uint8_t>&, int);
+template LSBStats Steganalysis::analyze<uint16_t>(const GrayscaleImageT<uint16_t>&, int);
+template LSBStats Steganalysis::analyze<int>(const GrayscaleImageT<int>&, int);
@@ -0,0 +1,42 @@
+#ifndef STEGANALYSIS_H
+#define STEGANALYSIS_H
+
+#include "GrayscaleImage.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// LSB-plane statistics of one image. Histograms use the low 8 bits of each pixel.
+struct LSBStats {
+    static const int MAX_RUN_LENGTH = 64;
+
+    int width, height;
+    long long histogram[256];        // Pixel value histogram
+    long long bit_plane_ones[8];     // Set bits per bit plane, plane 0 is the LSB plane
+    long long lsb_transitions;       // Neighboring pixels along a row whose LSBs differ
+    long long run_lengths[MAX_RUN_LENGTH + 1]; // Runs of equal LSBs along rows by length, longer runs in the last bin
+    double chi_square;               // Pairs-of-values statistic over the histogram
+    int degrees_of_freedom;
+    double embedding_probability;    // Upper tail probability of chi_square, near 1 for a full LSB payload
+    double run_length_entropy;       // Shannon entropy of the run length distribution in bits
+    std::string error;               // Why the file could not be scanned, empty on success
+};
+
+// Screens images for existing LSB payloads before they are reused as covers.
+class Steganalysis {
+public:
+    // Compute the LSB-plane statistics of an image, splitting it into row bands
+    // on up to `threads` threads (0 for one per core). Provided for uint8_t, uint16_t and int images.
+    template <typename PixelT>
+    static LSBStats analyze(const GrayscaleImageT<PixelT>& image, int threads = 0);
+
+    // Load and analyze many image files in parallel, one image per thread at a time,
+    // 16-bit files as uint16_t images so the true LSB plane is analyzed.
+    // Files that can't be loaded get an error message in their stats instead of stopping the scan.
+    static std::vector<LSBStats> scan_files(const std::vector<std::string>& filenames, int threads = 0);
+
+    // Write one tab-separated report line for an image, or its name and error if it failed
+    static void write_report(std::ostream& out, const std::string& name, const LSBStats& stats);
+};
+
+#endif // STEGANALYSIS_H